@@ -38,6 +38,11 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
 {
     return this->_attackers_mask(color, square, this->occupied);
 }
+Bitboard BaseBoard::attackers_mask(Color color, Square square, Bitboard occupied) const
+{
+    /* Attackers of *square* as if the board were occupied by *occupied*. */
+    return this->_attackers_mask(color, square, occupied);
+}
 
 
     void BaseBoard::reset_board()
@@ -87,19 +92,20 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
 
         Bitboard square_mask = BB_SQUARES[square];
 
-        for (auto [attacks, sliders] : {std::make_tuple(BB_FILE_ATTACKS, this->rooks | this->queens),
-                                        std::make_tuple(BB_RANK_ATTACKS, this->rooks | this->queens),
-                                        std::make_tuple(BB_DIAG_ATTACKS, this->bishops | this->queens)})
+        // Point to the attack tables: copying them would copy every map.
+        for (auto [attacks, sliders] : {std::make_tuple(&BB_FILE_ATTACKS, this->rooks | this->queens),
+                                        std::make_tuple(&BB_RANK_ATTACKS, this->rooks | this->queens),
+                                        std::make_tuple(&BB_DIAG_ATTACKS, this->bishops | this->queens)})
         {
-            Bitboard rays = attacks[*king].at(0);
+            Bitboard rays = (*attacks)[*king].at(0);
             if (rays & square_mask)
             {
                 Bitboard snipers = rays & sliders & this->occupied_co[!color];
-                for (Square sniper : scan_reversed(snipers))
+                for (; snipers; snipers &= snipers - 1)
                 {
-                    if ((between(sniper, *king) & (this->occupied | square_mask)) == square_mask)
+                    if ((between(lsb(snipers), *king) & (this->occupied | square_mask)) == square_mask)
                     {
-                        return ray(*king, sniper);
+                        return ray(*king, lsb(snipers));
                     }
                 }
 
@@ -221,6 +227,7 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
         this->occupied_co[WHITE] = BB_RANK_1 | BB_RANK_2;
         this->occupied_co[BLACK] = BB_RANK_7 | BB_RANK_8;
         this->occupied = BB_RANK_1 | BB_RANK_2 | BB_RANK_7 | BB_RANK_8;
+        this->_refresh_incremental();
     }
 
     void BaseBoard::_clear_board()
@@ -237,6 +244,56 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
         this->occupied_co[WHITE] = BB_EMPTY;
         this->occupied_co[BLACK] = BB_EMPTY;
         this->occupied = BB_EMPTY;
+        this->_refresh_incremental();
+    }
+
+    void BaseBoard::_refresh_incremental()
+    {
+        /*
+        Recomputes the Zobrist keys, the material and the piece square sum
+        from the bitboards, after they were replaced wholesale.
+        */
+        this->pawn_key = this->compute_pawn_key();
+        this->piece_key = 0;
+        this->polyglot_piece_key = 0;
+        this->material_key = 0;
+        this->psq = 0;
+        for (Color color : {WHITE, BLACK})
+        {
+            this->non_pawn_material[color] = 0;
+            for (PieceType piece_type = PAWN; piece_type <= KING; ++piece_type)
+            {
+                Bitboard bb = this->pieces_mask(piece_type, color);
+                this->piece_count[color][piece_type] = popcount(bb);
+                for (int i = 0; i < this->piece_count[color][piece_type]; ++i)
+                {
+                    this->material_key ^= ZOBRIST.pieces[color][piece_type][i];
+                }
+                this->non_pawn_material[color] += NON_PAWN_VALUES[piece_type] * popcount(bb);
+                for (; bb; bb &= bb - 1)
+                {
+                    this->piece_key ^= ZOBRIST.pieces[color][piece_type][lsb(bb)];
+                    this->polyglot_piece_key ^= polyglot_piece(color, piece_type, lsb(bb));
+                    this->psq += PSQ.pieces[color][piece_type][lsb(bb)];
+                }
+            }
+        }
+    }
+
+    bool BaseBoard::check_incremental() const
+    {
+        /*
+        Checks that the incrementally updated Zobrist keys, material and
+        piece square sum agree with the bitboards. Meant for assertions in
+        debug builds.
+        */
+        BaseBoard board = this->copy();
+        board._refresh_incremental();
+        return board.pawn_key == this->pawn_key && board.piece_key == this->piece_key &&
+               board.polyglot_piece_key == this->polyglot_piece_key &&
+               board.material_key == this->material_key && board.psq == this->psq &&
+               std::equal(&board.non_pawn_material[0], &board.non_pawn_material[0] + 2, &this->non_pawn_material[0]) &&
+               std::equal(&board.piece_count[0][0], &board.piece_count[0][0] + 14, &this->piece_count[0][0]);
     }
 
     Bitboard BaseBoard::attacks_mask(Square square) const
@@ -287,6 +344,14 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
         board.occupied_co[BLACK] = this->occupied_co[BLACK];
         board.occupied = this->occupied;
         board.promoted = this->promoted;
+        board.pawn_key = this->pawn_key;
+        board.piece_key = this->piece_key;
+        board.polyglot_piece_key = this->polyglot_piece_key;
+        board.material_key = this->material_key;
+        board.non_pawn_material[WHITE] = this->non_pawn_material[WHITE];
+        board.non_pawn_material[BLACK] = this->non_pawn_material[BLACK];
+        std::copy(&this->piece_count[0][0], &this->piece_count[0][0] + 14, &board.piece_count[0][0]);
+        board.psq = this->psq;
 
         return board;
     }
@@ -307,27 +372,28 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
         std::optional<PieceType> piece_type = this->piece_type_at(square);
         Bitboard mask = BB_SQUARES[square];
 
-        if (*piece_type == PAWN)
+        if (piece_type == PAWN)
         {
             this->pawns ^= mask;
+            this->pawn_key ^= ZOBRIST.pieces[bool(this->occupied_co[WHITE] & mask)][PAWN][square];
         }
-        else if (*piece_type == KNIGHT)
+        else if (piece_type == KNIGHT)
         {
             this->knights ^= mask;
         }
-        else if (*piece_type == BISHOP)
+        else if (piece_type == BISHOP)
         {
             this->bishops ^= mask;
         }
-        else if (*piece_type == ROOK)
+        else if (piece_type == ROOK)
         {
             this->rooks ^= mask;
         }
-        else if (*piece_type == QUEEN)
+        else if (piece_type == QUEEN)
         {
             this->queens ^= mask;
         }
-        else if (*piece_type == KING)
+        else if (piece_type == KING)
         {
             this->kings ^= mask;
         }
@@ -336,6 +402,14 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
             return std::nullopt;
         }
 
+        Color color = bool(this->occupied_co[WHITE] & mask);
+        this->non_pawn_material[color] -= NON_PAWN_VALUES[*piece_type];
+        --this->piece_count[color][*piece_type];
+        this->material_key ^= ZOBRIST.pieces[color][*piece_type][this->piece_count[color][*piece_type]];
+        this->piece_key ^= ZOBRIST.pieces[color][*piece_type][square];
+        this->polyglot_piece_key ^= polyglot_piece(color, *piece_type, square);
+        this->psq -= PSQ.pieces[color][*piece_type][square];
+        this->dirty_pieces.add(square, *piece_type, color, false);
         this->occupied ^= mask;
         this->occupied_co[WHITE] &= ~mask;
         this->occupied_co[BLACK] &= ~mask;
@@ -354,6 +428,7 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
         if (piece_type == PAWN)
         {
             this->pawns |= mask;
+            this->pawn_key ^= ZOBRIST.pieces[color][PAWN][square];
         }
         else if (piece_type == KNIGHT)
         {
@@ -380,6 +455,13 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
             return;
         }
 
+        this->non_pawn_material[color] += NON_PAWN_VALUES[piece_type];
+        this->material_key ^= ZOBRIST.pieces[color][piece_type][this->piece_count[color][piece_type]];
+        ++this->piece_count[color][piece_type];
+        this->piece_key ^= ZOBRIST.pieces[color][piece_type][square];
+        this->polyglot_piece_key ^= polyglot_piece(color, piece_type, square);
+        this->psq += PSQ.pieces[color][piece_type][square];
+        this->dirty_pieces.add(square, piece_type, color, true);
         this->occupied ^= mask;
         this->occupied_co[color] ^= mask;
 
@@ -389,6 +471,18 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
         }
     }
 
+    static const auto _FEN_PIECE_TYPES = []
+    {
+        // The piece type of each piece symbol of a FEN, 0 for other characters.
+        std::array<PieceType, 256> piece_types{};
+        for (PieceType piece_type = PAWN; piece_type <= KING; ++piece_type)
+        {
+            piece_types[(unsigned char)*PIECE_SYMBOLS[piece_type]] = piece_type;
+            piece_types[(unsigned char)std::toupper(*PIECE_SYMBOLS[piece_type])] = piece_type;
+        }
+        return piece_types;
+    }();
+
     void BaseBoard::_set_board_fen(std::string fen)
     {
         // Compatibility with set_fen().
@@ -408,86 +502,83 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
             throw std::invalid_argument("expected position part of fen, got multiple parts: \"" + fen + "\"");
         }
 
-        // Ensure the FEN is valid.
-        std::vector<std::string> rows;
-        for (size_t i = 0, dist = 0; i < fen.length(); ++i, ++dist)
-        {
-            if (fen[i] == '/')
-            {
-                rows.push_back(fen.substr(i++ - dist, dist));
-                dist = 0;
-            }
-            else if (i == fen.length() - 1)
-            {
-                rows.push_back(fen.substr(i - dist));
-            }
-        }
-        if (rows.size() != 8)
+        // Ensure the FEN is valid. Validated in place, without splitting
+        // into rows: set_fen() is on the hot path of batch processing.
+        if (std::count(fen.begin(), fen.end(), '/') != 7)
         {
             throw std::invalid_argument("expected 8 rows in position part of fen: \"" + fen + "\"");
         }
 
         // Validate each row.
-        for (const std::string &row : rows)
+        int field_sum = 0;
+        bool previous_was_digit = false;
+        bool previous_was_piece = false;
+        for (size_t i = 0; i <= fen.size(); ++i)
         {
-            int field_sum = 0;
-            bool previous_was_digit = false;
-            bool previous_was_piece = false;
-
-            for (char c : row)
+            char c = i < fen.size() ? fen[i] : '/';
+            if (c == '/')
             {
-                if (c == '1' || c == '2' || c == '3' || c == '4' || c == '5' || c == '6' || c == '7' || c == '8')
+                if (field_sum != 8)
                 {
-                    if (previous_was_digit)
-                    {
-                        throw std::invalid_argument("two subsequent digits in position part of fen: \"" + fen + "\"");
-                    }
-                    field_sum += c - '0';
-                    previous_was_digit = true;
-                    previous_was_piece = false;
+                    throw std::invalid_argument("expected 8 columns per row in position part of fen: \"" + fen + "\"");
                 }
-                else if (c == '~')
-                {
-                    if (!previous_was_piece)
-                    {
-                        throw std::invalid_argument("'~' not after piece in position part of fen: \"" + fen + "\"");
-                    }
-                    previous_was_digit = false;
-                    previous_was_piece = false;
-                }
-                else if (std::find(std::begin(PIECE_SYMBOLS), std::end(PIECE_SYMBOLS), std::tolower(c)) != std::end(PIECE_SYMBOLS))
+                field_sum = 0;
+                previous_was_digit = false;
+                previous_was_piece = false;
+            }
+            else if (c >= '1' && c <= '8')
+            {
+                if (previous_was_digit)
                 {
-                    ++field_sum;
-                    previous_was_digit = false;
-                    previous_was_piece = true;
+                    throw std::invalid_argument("two subsequent digits in position part of fen: \"" + fen + "\"");
                 }
-                else
+                field_sum += c - '0';
+                previous_was_digit = true;
+                previous_was_piece = false;
+            }
+            else if (c == '~')
+            {
+                if (!previous_was_piece)
                 {
-                    throw std::invalid_argument("invalid character in position part of fen: \"" + fen + "\"");
+                    throw std::invalid_argument("'~' not after piece in position part of fen: \"" + fen + "\"");
                 }
+                previous_was_digit = false;
+                previous_was_piece = false;
             }
-
-            if (field_sum != 8)
+            else if (_FEN_PIECE_TYPES[(unsigned char)c])
+            {
+                ++field_sum;
+                previous_was_digit = false;
+                previous_was_piece = true;
+            }
+            else
             {
-                throw std::invalid_argument("expected 8 columns per row in position part of fen: \"" + fen + "\"");
+                throw std::invalid_argument("invalid character in position part of fen: \"" + fen + "\"");
             }
         }
 
-        // Clear the board.
-        this->_clear_board();
-
-        // Put pieces on the board.
+        // Put pieces on the board, then compute the keys once, like
+        // _reset_board().
+        Bitboard *piece_masks[] = {nullptr, &this->pawns, &this->knights, &this->bishops, &this->rooks, &this->queens, &this->kings};
+        for (PieceType piece_type = PAWN; piece_type <= KING; ++piece_type)
+        {
+            *piece_masks[piece_type] = BB_EMPTY;
+        }
+        this->promoted = BB_EMPTY;
+        this->occupied_co[WHITE] = BB_EMPTY;
+        this->occupied_co[BLACK] = BB_EMPTY;
         int square_index = 0;
         for (char c : fen)
         {
-            if (c == '1' || c == '2' || c == '3' || c == '4' || c == '5' || c == '6' || c == '7' || c == '8')
+            if (c >= '1' && c <= '8')
             {
                 square_index += c - '0';
             }
-            else if (std::find(std::begin(PIECE_SYMBOLS), std::end(PIECE_SYMBOLS), std::tolower(c)) != std::end(PIECE_SYMBOLS))
+            else if (_FEN_PIECE_TYPES[(unsigned char)c])
             {
-                Piece piece = Piece::from_symbol(c);
-                this->_set_piece_at(SQUARES_180[square_index], piece.piece_type, piece.color);
+                Bitboard mask = BB_SQUARES[SQUARES_180[square_index]];
+                *piece_masks[_FEN_PIECE_TYPES[(unsigned char)c]] |= mask;
+                this->occupied_co[c >= 'A' && c <= 'Z'] |= mask;
                 ++square_index;
             }
             else if (c == '~')
@@ -495,6 +586,8 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
                 this->promoted |= BB_SQUARES[SQUARES_180[square_index - 1]];
             }
         }
+        this->occupied = this->occupied_co[WHITE] | this->occupied_co[BLACK];
+        this->_refresh_incremental();
     }
 
     std::optional<Square> BaseBoard::king(Color color) const
@@ -614,10 +707,59 @@ Bitboard BaseBoard::attackers_mask(Color color, Square square) const
         return bb & this->occupied_co[color];
     }
 
+    void BaseBoard::apply_transform(const std::function<Bitboard(Bitboard)> &f)
+    {
+        this->pawns = f(this->pawns);
+        this->knights = f(this->knights);
+        this->bishops = f(this->bishops);
+        this->rooks = f(this->rooks);
+        this->queens = f(this->queens);
+        this->kings = f(this->kings);
+
+        this->occupied_co[WHITE] = f(this->occupied_co[WHITE]);
+        this->occupied_co[BLACK] = f(this->occupied_co[BLACK]);
+        this->occupied = f(this->occupied);
+        this->promoted = f(this->promoted);
+        this->_refresh_incremental();
+    }
+
+    BaseBoard BaseBoard::transform(const std::function<Bitboard(Bitboard)> &f) const
+    {
+        /*
+        Returns a transformed copy of the board by applying a bitboard
+        transformation function.
+
+        Available transformations include :func:`flip_vertical()`,
+        :func:`flip_horizontal()`, :func:`flip_diagonal()` and
+        :func:`flip_anti_diagonal()`.
+        */
+        BaseBoard board = this->copy();
+        board.apply_transform(f);
+        return board;
+    }
+
     void BaseBoard::apply_mirror()
     {
         this->apply_transform(flip_vertical);
         std::swap(this->occupied_co[WHITE], this->occupied_co[BLACK]);
+        this->_refresh_incremental();
+    }
+
+    Bitboard BaseBoard::compute_pawn_key() const
+    {
+        /*
+        Computes :data:`~BaseBoard::pawn_key` from scratch. It is kept up to
+        date incrementally, so this is only needed to verify it.
+        */
+        Bitboard key = 0;
+        for (Color color : {WHITE, BLACK})
+        {
+            for (Bitboard bb = this->pawns & this->occupied_co[color]; bb; bb &= bb - 1)
+            {
+                key ^= ZOBRIST.pieces[color][PAWN][lsb(bb)];
+            }
+        }
+        return key;
     }
 
     BaseBoard BaseBoard::mirror() const
@@ -3,6 +3,45 @@
 #include "movegen.h"
 #include "Piece.h"
 #include "Move.h"
+#include "zobrist.h"
+#include "psqt.h"
+class DirtyPieces
+{
+    /*
+    The pieces put on and taken off a board, in order. A move changes at
+    most four: castling moves two pieces.
+    */
+    public:
+        static const int MAX = 4;
+
+        int size = 0;
+        /* The number of changes, :data:`MAX` + 1 if some were not recorded. */
+
+        Square squares[MAX];
+
+        PieceType piece_types[MAX];
+
+        Color colors[MAX];
+
+        bool added[MAX];
+
+        void clear()
+        {
+            this->size = 0;
+        }
+
+        void add(Square square, PieceType piece_type, Color color, bool added)
+        {
+            if (this->size < MAX)
+            {
+                this->squares[this->size] = square;
+                this->piece_types[this->size] = piece_type;
+                this->colors[this->size] = color;
+                this->added[this->size] = added;
+            }
+            this->size += this->size <= MAX;
+        }
+};
 class BaseBoard
 {
     public:
@@ -18,8 +57,17 @@ class BaseBoard
         unsigned long long knights=0; //!< Member variable "knights;"
         unsigned long long kings=0; //!< Member variable "kings;"
         unsigned long long promoted=0;
+        Bitboard pawn_key=0; //!< Zobrist key of the pawns only, updated incrementally.
+        Bitboard piece_key=0; //!< Zobrist key of all pieces, updated incrementally.
+        Bitboard polyglot_piece_key=0; //!< Polyglot key of all pieces, the piece part of Board::polyglot_key(), updated incrementally.
+        Bitboard material_key=0; //!< Zobrist key of the piece counts of each color and type, updated incrementally.
+        int non_pawn_material[2]={0, 0}; //!< Sum of NON_PAWN_VALUES of the pieces of each color, updated incrementally.
+        int piece_count[2][7]={}; //!< Number of pieces of each color and type, updated incrementally.
+        Score psq=0; //!< Sum of PSQ over all pieces: material and square bonuses from white's point of view, updated incrementally.
+        DirtyPieces dirty_pieces; //!< Pieces put on and taken off the board since the last Board::push().
         //Bitboard checkers_mask() const;
         Bitboard attackers_mask(Color, Square) const;
+        Bitboard attackers_mask(Color, Square, Bitboard) const;
         void reset_board();
 
         void clear_board();
@@ -50,11 +98,17 @@ class BaseBoard
         void apply_mirror();
 
         BaseBoard mirror() const;
+
+        Bitboard compute_pawn_key() const;
+
+        bool check_incremental() const;
     protected:
         void _reset_board();
 
         void _clear_board();
 
+        void _refresh_incremental();
+
         Bitboard _attackers_mask(Color, Square, Bitboard) const;
 
         std::optional<PieceType> _remove_piece_at(Square);
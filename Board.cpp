@@ -1,4 +1,8 @@
 #include "Board.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PACK_X86
+#endif
 
     _BoardState::_BoardState(const Board &board)
     {
@@ -14,6 +18,14 @@
         this->occupied = board.occupied;
 
         this->promoted = board.promoted;
+        this->pawn_key = board.pawn_key;
+        this->piece_key = board.piece_key;
+        this->polyglot_piece_key = board.polyglot_piece_key;
+        this->material_key = board.material_key;
+        this->non_pawn_material[WHITE] = board.non_pawn_material[WHITE];
+        this->non_pawn_material[BLACK] = board.non_pawn_material[BLACK];
+        std::copy(&board.piece_count[0][0], &board.piece_count[0][0] + 14, &this->piece_count[0][0]);
+        this->psq = board.psq;
 
         this->turn = board.turn;
         this->castling_rights = board.castling_rights;
@@ -36,6 +48,14 @@
         board.occupied = this->occupied;
 
         board.promoted = this->promoted;
+        board.pawn_key = this->pawn_key;
+        board.piece_key = this->piece_key;
+        board.polyglot_piece_key = this->polyglot_piece_key;
+        board.material_key = this->material_key;
+        board.non_pawn_material[WHITE] = this->non_pawn_material[WHITE];
+        board.non_pawn_material[BLACK] = this->non_pawn_material[BLACK];
+        std::copy(&this->piece_count[0][0], &this->piece_count[0][0] + 14, &board.piece_count[0][0]);
+        board.psq = this->psq;
 
         board.turn = this->turn;
         board.castling_rights = this->castling_rights;
@@ -345,8 +365,7 @@
 
         // If already in check, look if it is an evasion.
         Bitboard checkers = this->attackers_mask(!this->turn, *king);
-        std::vector<Move> evasions = this->_generate_evasions(*king, checkers, BB_SQUARES[move.from_square], BB_SQUARES[move.to_square]);
-        if (checkers && std::find(std::begin(evasions), std::end(evasions), move) == std::end(evasions))
+        if (checkers && !this->_is_evasion(*king, checkers, move))
         {
             return true;
         }
@@ -413,10 +432,14 @@
         if (*piece == KING)
         {
             move = this->_from_chess960(this->chess960, move.from_square, move.to_square);
-            std::vector<Move> castling_moves = this->generate_castling_moves();
-            if (std::find(std::begin(castling_moves), std::end(castling_moves), move) != std::end(castling_moves))
+            Bitboard backrank = this->turn == WHITE ? BB_RANK_1 : BB_RANK_8;
+            Bitboard rooks = from_mask & ~this->promoted & backrank ? this->clean_castling_rights() & backrank : BB_EMPTY;
+            for (; rooks; rooks &= rooks - 1)
             {
-                return true;
+                if (move == this->_from_chess960(this->chess960, move.from_square, lsb(rooks)) && this->_can_castle(from_mask, lsb(rooks)))
+                {
+                    return true;
+                }
             }
         }
 
@@ -426,11 +449,33 @@
             return false;
         }
 
-        // Handle pawn moves.
+        // Handle pawn moves like generate_pseudo_legal_moves(), without
+        // generating them: moves to the backrank promote to a knight, bishop,
+        // rook or queen.
         if (*piece == PAWN)
         {
-            std::vector<Move> pseudo_legal_moves = this->generate_pseudo_legal_moves(from_mask, to_mask);
-            return std::find(std::begin(pseudo_legal_moves), std::end(pseudo_legal_moves), move) != std::end(pseudo_legal_moves);
+            bool backrank = square_rank(move.to_square) == 0 || square_rank(move.to_square) == 7;
+            if (backrank != bool(move.promotion) || (move.promotion && (*move.promotion < KNIGHT || *move.promotion > QUEEN)))
+            {
+                return false;
+            }
+
+            // Captures, including en passant.
+            if (BB_PAWN_ATTACKS[this->turn][move.from_square] & to_mask)
+            {
+                return bool(this->occupied_co[!this->turn] & to_mask) ||
+                       (this->ep_square == move.to_square && !(this->occupied & to_mask) && (from_mask & BB_RANKS[this->turn ? 4 : 3]));
+            }
+
+            // Single and double pushes.
+            int forward = this->turn == WHITE ? 8 : -8;
+            if (move.to_square == move.from_square + forward)
+            {
+                return !(this->occupied & to_mask);
+            }
+            Bitboard double_ranks = this->turn == WHITE ? BB_RANK_3 | BB_RANK_4 : BB_RANK_6 | BB_RANK_5;
+            return move.to_square == move.from_square + 2 * forward && (to_mask & double_ranks) &&
+                   !(this->occupied & (to_mask | BB_SQUARES[move.from_square + forward]));
         }
 
         // Handle all other pieces.
@@ -806,6 +851,7 @@
         this->castling_rights = this->clean_castling_rights(); // Before pushing stack
         this->move_stack.push_back(this->_from_chess960(this->chess960, move.from_square, move.to_square, move.promotion, move.drop));
         this->_stack.push_back(board_state);
+        this->dirty_pieces.clear();
 
         // Reset en passant square.
         std::optional<Square> ep_square = this->ep_square;
@@ -821,6 +867,7 @@
         // On a null move, simply swap turns and reset the en passant square.
         if (!move)
         {
+            this->_stack.back().dirty_pieces = this->dirty_pieces;
             this->turn = !this->turn;
             return;
         }
@@ -829,6 +876,7 @@
         if (move.drop)
         {
             this->_set_piece_at(move.to_square, *move.drop, this->turn);
+            this->_stack.back().dirty_pieces = this->dirty_pieces;
             this->turn = !this->turn;
             return;
         }
@@ -939,6 +987,7 @@
         }
 
         // Swap turn.
+        this->_stack.back().dirty_pieces = this->dirty_pieces;
         this->turn = !this->turn;
     }
 
@@ -960,6 +1009,327 @@
         return move;
     }
 
+    const std::vector<_BoardState> &Board::states() const
+    {
+        /*
+        The states saved by :func:`Board::push()`, one for each move of the
+        :data:`move stack <chess::Board::move_stack>`: the position before
+        the move and the pieces the move changed.
+        */
+        return this->_stack;
+    }
+
+    static Bitboard _pext_scalar(Bitboard bb, Bitboard mask)
+    {
+        Bitboard result = 0;
+        for (Bitboard bit = 1; mask; mask &= mask - 1, bit <<= 1)
+        {
+            result |= bb & mask & -mask ? bit : 0;
+        }
+        return result;
+    }
+
+    static Bitboard _pdep_scalar(Bitboard bb, Bitboard mask)
+    {
+        Bitboard result = 0;
+        for (Bitboard bit = 1; mask; mask &= mask - 1, bit <<= 1)
+        {
+            result |= bb & bit ? mask & -mask : 0;
+        }
+        return result;
+    }
+
+    // The pieces are packed as one nibble per occupied square, in square
+    // order: bits 0-2 the piece type, bit 3 set for black. Each bit of the
+    // nibbles is a plane, the pieces having that bit extracted from the
+    // occupancy, so packing takes four extracts and eight deposits instead
+    // of a loop over the squares. Unpacking is the reverse.
+    static const Bitboard _NIBBLE_BITS = 0x1111111111111111ULL;
+
+    static void _pack_pieces_scalar(const Board &board, uint8_t *nibbles)
+    {
+        Bitboard planes[4] = {
+            _pext_scalar(board.pawns | board.bishops | board.queens, board.occupied),
+            _pext_scalar(board.knights | board.bishops | board.kings, board.occupied),
+            _pext_scalar(board.rooks | board.queens | board.kings, board.occupied),
+            _pext_scalar(board.occupied_co[BLACK], board.occupied)};
+        for (int half = 0; half < 2; ++half)
+        {
+            Bitboard bb = 0;
+            for (int bit = 0; bit < 4; ++bit)
+            {
+                bb |= _pdep_scalar(planes[bit] >> (16 * half), _NIBBLE_BITS << bit);
+            }
+            for (int i = 0; i < 8; ++i)
+            {
+                nibbles[8 * half + i] = uint8_t(bb >> (8 * i));
+            }
+        }
+    }
+
+    static void _unpack_pieces_scalar(Bitboard occupied, const uint8_t *nibbles, Bitboard *pieces)
+    {
+        Bitboard planes[4] = {};
+        for (int half = 0; half < 2; ++half)
+        {
+            Bitboard bb = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                bb |= Bitboard(nibbles[8 * half + i]) << (8 * i);
+            }
+            for (int bit = 0; bit < 4; ++bit)
+            {
+                planes[bit] |= _pext_scalar(bb, _NIBBLE_BITS << bit) << (16 * half);
+            }
+        }
+        Bitboard p0 = planes[0], p1 = planes[1], p2 = planes[2];
+        pieces[0] = _pdep_scalar(p0 & ~p1 & ~p2, occupied);
+        pieces[1] = _pdep_scalar(~p0 & p1 & ~p2, occupied);
+        pieces[2] = _pdep_scalar(p0 & p1 & ~p2, occupied);
+        pieces[3] = _pdep_scalar(~p0 & ~p1 & p2, occupied);
+        pieces[4] = _pdep_scalar(p0 & ~p1 & p2, occupied);
+        pieces[5] = _pdep_scalar(~p0 & p1 & p2, occupied);
+        pieces[6] = _pdep_scalar(planes[3], occupied);
+    }
+
+#ifdef PACK_X86
+    __attribute__((target("bmi2"))) static void _pack_pieces_bmi2(const Board &board, uint8_t *nibbles)
+    {
+        Bitboard planes[4] = {
+            _pext_u64(board.pawns | board.bishops | board.queens, board.occupied),
+            _pext_u64(board.knights | board.bishops | board.kings, board.occupied),
+            _pext_u64(board.rooks | board.queens | board.kings, board.occupied),
+            _pext_u64(board.occupied_co[BLACK], board.occupied)};
+        for (int half = 0; half < 2; ++half)
+        {
+            Bitboard bb = 0;
+            for (int bit = 0; bit < 4; ++bit)
+            {
+                bb |= _pdep_u64(planes[bit] >> (16 * half), _NIBBLE_BITS << bit);
+            }
+            for (int i = 0; i < 8; ++i)
+            {
+                nibbles[8 * half + i] = uint8_t(bb >> (8 * i));
+            }
+        }
+    }
+
+    __attribute__((target("bmi2"))) static void _unpack_pieces_bmi2(Bitboard occupied, const uint8_t *nibbles, Bitboard *pieces)
+    {
+        Bitboard planes[4] = {};
+        for (int half = 0; half < 2; ++half)
+        {
+            Bitboard bb = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                bb |= Bitboard(nibbles[8 * half + i]) << (8 * i);
+            }
+            for (int bit = 0; bit < 4; ++bit)
+            {
+                planes[bit] |= _pext_u64(bb, _NIBBLE_BITS << bit) << (16 * half);
+            }
+        }
+        Bitboard p0 = planes[0], p1 = planes[1], p2 = planes[2];
+        pieces[0] = _pdep_u64(p0 & ~p1 & ~p2, occupied);
+        pieces[1] = _pdep_u64(~p0 & p1 & ~p2, occupied);
+        pieces[2] = _pdep_u64(p0 & p1 & ~p2, occupied);
+        pieces[3] = _pdep_u64(~p0 & ~p1 & p2, occupied);
+        pieces[4] = _pdep_u64(p0 & ~p1 & p2, occupied);
+        pieces[5] = _pdep_u64(~p0 & p1 & p2, occupied);
+        pieces[6] = _pdep_u64(planes[3], occupied);
+    }
+#endif
+
+    class _PackKernels
+    {
+        // Bit extract and deposit are single instructions with BMI2. The
+        // implementation is selected once at runtime.
+    public:
+        void (*pack)(const Board &, uint8_t *);
+
+        void (*unpack)(Bitboard, const uint8_t *, Bitboard *);
+    };
+
+    static const _PackKernels &_pack_kernels()
+    {
+        static const _PackKernels kernels = []
+        {
+#ifdef PACK_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("bmi2"))
+            {
+                return _PackKernels{_pack_pieces_bmi2, _unpack_pieces_bmi2};
+            }
+#endif
+            return _PackKernels{_pack_pieces_scalar, _unpack_pieces_scalar};
+        }();
+        return kernels;
+    }
+
+    void Board::pack(uint8_t *data) const
+    {
+        /*
+        Writes the position to the :data:`PACKED_SIZE` bytes at *data*:
+
+        - bytes 0-7: the occupied squares, little-endian
+        - bytes 8-23: a nibble for each occupied square in square order, the
+          low nibble of a byte first: the piece type, plus 8 for black
+        - byte 24: bit 0 set if black is to move, bit 1 for Chess960
+        - bytes 25-26: castling rights, the rooks on the first and the
+          eighth rank
+        - byte 27: the en passant square, 64 if there is none
+        - bytes 28-29 and 30-31: the halfmove clock and the fullmove number,
+          little-endian and capped at 65535
+
+        The move stack and promoted pieces are not stored.
+
+        :throws: :exc:`std::invalid_argument` if there are more than 32 pieces.
+        */
+        if (popcount(this->occupied) > 32)
+        {
+            throw std::invalid_argument("cannot pack more than 32 pieces: " + this->board_fen());
+        }
+        for (int i = 0; i < 8; ++i)
+        {
+            data[i] = uint8_t(this->occupied >> (8 * i));
+        }
+        _pack_kernels().pack(*this, data + 8);
+        Bitboard castling = this->clean_castling_rights();
+        int halfmove_clock = std::clamp(this->halfmove_clock, 0, 0xFFFF);
+        int fullmove_number = std::clamp(this->fullmove_number, 0, 0xFFFF);
+        data[24] = (this->turn == BLACK) | this->chess960 << 1;
+        data[25] = uint8_t(castling);
+        data[26] = uint8_t(castling >> 56);
+        data[27] = this->ep_square ? *this->ep_square : 64;
+        data[28] = uint8_t(halfmove_clock);
+        data[29] = uint8_t(halfmove_clock >> 8);
+        data[30] = uint8_t(fullmove_number);
+        data[31] = uint8_t(fullmove_number >> 8);
+    }
+
+    void Board::unpack(const uint8_t *data)
+    {
+        /*
+        Sets the position from :data:`PACKED_SIZE` bytes written by
+        :func:`Board::pack()` and clears the move stack.
+
+        :throws: :exc:`std::invalid_argument` if a piece code or the en
+            passant square is invalid. The board is left in an unspecified
+            state then.
+        */
+        Bitboard pieces[7];
+        if (!unpack_pieces(data, pieces) || data[27] > 64)
+        {
+            throw std::invalid_argument("invalid packed board");
+        }
+        this->pawns = pieces[0];
+        this->knights = pieces[1];
+        this->bishops = pieces[2];
+        this->rooks = pieces[3];
+        this->queens = pieces[4];
+        this->kings = pieces[5];
+        this->occupied = pieces[0] | pieces[1] | pieces[2] | pieces[3] | pieces[4] | pieces[5];
+        this->occupied_co[BLACK] = pieces[6];
+        this->occupied_co[WHITE] = this->occupied & ~pieces[6];
+        this->promoted = BB_EMPTY;
+        this->turn = data[24] & 1 ? BLACK : WHITE;
+        this->chess960 = data[24] & 2;
+        this->castling_rights = Bitboard(data[25]) | Bitboard(data[26]) << 56;
+        this->ep_square = data[27] < 64 ? std::optional<Square>(data[27]) : std::nullopt;
+        this->halfmove_clock = data[28] | data[29] << 8;
+        this->fullmove_number = data[30] | data[31] << 8;
+        this->_refresh_incremental();
+        this->clear_stack();
+    }
+
+    int Board::encode_move(const Move &move) const
+    {
+        /*
+        Encodes a legal move or a null move in this position as 16 bits, like
+        :func:`encode_raw_move()`, and marks en passant captures and castling
+        moves with :data:`RAW_MOVE_EN_PASSANT` and :data:`RAW_MOVE_CASTLING`.
+        Castling is stored as the king moving to its rook, so Chess960
+        castling is unambiguous. Null moves are ``0``.
+        */
+        if (!move)
+        {
+            return 0;
+        }
+        if (this->is_castling(move))
+        {
+            Move king_move = this->_to_chess960(move);
+            return encode_raw_move(Move(king_move.from_square, king_move.to_square)) | RAW_MOVE_CASTLING;
+        }
+        return encode_raw_move(move) | (this->is_en_passant(move) ? RAW_MOVE_EN_PASSANT : 0);
+    }
+
+    Move Board::decode_move(int raw_move) const
+    {
+        /*
+        Decodes a move encoded by :func:`Board::encode_move()` in this
+        position, in the castling notation of the board. Does not check
+        legality.
+        */
+        Move move = decode_raw_move(raw_move);
+        if (!move)
+        {
+            return Move::null();
+        }
+        if ((raw_move & 0x7000) == RAW_MOVE_CASTLING)
+        {
+            return this->_from_chess960(this->chess960, move.from_square, move.to_square);
+        }
+        return move;
+    }
+
+    void pack_boards(const Board *boards, size_t count, uint8_t *data)
+    {
+        /*
+        Packs *count* boards into ``count * Board::PACKED_SIZE`` bytes at
+        *data*, see :func:`Board::pack()`.
+        */
+        for (size_t i = 0; i < count; ++i)
+        {
+            boards[i].pack(data + i * Board::PACKED_SIZE);
+        }
+    }
+
+    bool unpack_pieces(const uint8_t *data, Bitboard *pieces)
+    {
+        /*
+        Writes the pieces of a position packed by :func:`Board::pack()` to
+        *pieces*, without the rest of the position: the pawns, knights,
+        bishops, rooks, queens and kings of both colors, then the pieces of
+        black.
+
+        Returns false if a piece code is invalid or there are more than 32
+        pieces.
+        */
+        Bitboard occupied = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            occupied |= Bitboard(data[i]) << (8 * i);
+        }
+        if (popcount(occupied) > 32)
+        {
+            return false;
+        }
+        _pack_kernels().unpack(occupied, data + 8, pieces);
+        return (pieces[0] | pieces[1] | pieces[2] | pieces[3] | pieces[4] | pieces[5]) == occupied;
+    }
+
+    void unpack_boards(const uint8_t *data, size_t count, Board *boards)
+    {
+        /*
+        Unpacks *count* boards packed by :func:`pack_boards()` into the
+        existing *boards*, reusing their memory.
+        */
+        for (size_t i = 0; i < count; ++i)
+        {
+            boards[i].unpack(data + i * Board::PACKED_SIZE);
+        }
+    }
+
     Move Board::peek() const
     {
         /*
@@ -974,6 +1344,57 @@
         return this->move_stack.back();
     }
 
+    Bitboard Board::zobrist_key() const
+    {
+        /*
+        Gets a 64-bit Zobrist hash of the position: pieces, side to move,
+        castling rights and en passant square (even if no capture is
+        possible). O(1), since the piece part is updated incrementally.
+        */
+        Bitboard key = this->piece_key;
+        for (Bitboard bb = this->castling_rights; bb; bb &= bb - 1)
+        {
+            key ^= ZOBRIST.castling[lsb(bb)];
+        }
+        if (this->ep_square)
+        {
+            key ^= ZOBRIST.ep_file[square_file(*this->ep_square)];
+        }
+        return this->turn == BLACK ? key ^ ZOBRIST.turn : key;
+    }
+
+    Bitboard Board::polyglot_key() const
+    {
+        /*
+        Gets the key of the position in Polyglot opening books. Unlike
+        :func:`~Board::zobrist_key()` the en passant file only counts if a
+        pawn of the side to move stands next to the pawn that can be
+        captured. The piece part is updated incrementally.
+        */
+        Bitboard key = this->polyglot_piece_key;
+        if (this->has_kingside_castling_rights(WHITE))
+        {
+            key ^= POLYGLOT_RANDOM[768];
+        }
+        if (this->has_queenside_castling_rights(WHITE))
+        {
+            key ^= POLYGLOT_RANDOM[769];
+        }
+        if (this->has_kingside_castling_rights(BLACK))
+        {
+            key ^= POLYGLOT_RANDOM[770];
+        }
+        if (this->has_queenside_castling_rights(BLACK))
+        {
+            key ^= POLYGLOT_RANDOM[771];
+        }
+        if (this->ep_square && BB_PAWN_ATTACKS[!this->turn][*this->ep_square] & this->pawns & this->occupied_co[this->turn])
+        {
+            key ^= POLYGLOT_RANDOM[772 + square_file(*this->ep_square)];
+        }
+        return this->turn == WHITE ? key ^ POLYGLOT_RANDOM[780] : key;
+    }
+
     Move Board::find_move(Square from_square, Square to_square, std::optional<PieceType> promotion)
     {
         /*
@@ -1118,6 +1539,26 @@
         return this->epd(true, en_passant, promoted) + " " + std::to_string(this->halfmove_clock) + " " + std::to_string(this->fullmove_number);
     }
 
+    static bool _is_castling_fen(const std::string &castling_fen)
+    {
+        // Matches FEN_CASTLING_REGEX without the cost of std::regex: "-", or
+        // up to two white flags followed by up to two black flags.
+        if (castling_fen == "-")
+        {
+            return true;
+        }
+        size_t i = 0, white = 0, black = 0;
+        for (; i < castling_fen.size() && std::string_view("KQABCDEFGH").find(castling_fen[i]) != std::string_view::npos; ++i)
+        {
+            ++white;
+        }
+        for (; i < castling_fen.size() && std::string_view("kqabcdefgh").find(castling_fen[i]) != std::string_view::npos; ++i)
+        {
+            ++black;
+        }
+        return i == castling_fen.size() && white <= 2 && black <= 2;
+    }
+
     void Board::set_fen(const std::string &fen)
     {
         /*
@@ -1126,8 +1567,19 @@
         :throws: :exc:`std::invalid_argument` if syntactically invalid. Use
             :func:`~Board::is_valid()` to detect invalid positions.
         */
-        std::istringstream iss(fen);
-        std::deque<std::string> parts = {std::istream_iterator<std::string>(iss), {}};
+        // Split on whitespace by hand: this is on the hot path of batch
+        // processing, where an istringstream costs more than the rest.
+        std::deque<std::string> parts;
+        for (size_t end = 0;;)
+        {
+            size_t start = fen.find_first_not_of(" \t\n\v\f\r", end);
+            if (start == std::string::npos)
+            {
+                break;
+            }
+            end = std::min(fen.find_first_of(" \t\n\v\f\r", start), fen.size());
+            parts.emplace_back(fen, start, end - start);
+        }
 
         // Board part.
         std::string board_part;
@@ -1174,7 +1626,7 @@
             castling_part = parts.front();
             parts.pop_front();
 
-            if (!regex_match(castling_part, FEN_CASTLING_REGEX))
+            if (!_is_castling_fen(castling_part))
             {
                 throw std::invalid_argument("invalid castling part in fen: \"" + fen + "\"");
             }
@@ -1623,7 +2075,7 @@
         std::optional<PieceType> promotion;
         if (!p.empty())
         {
-            auto it = std::find(std::begin(PIECE_SYMBOLS), std::end(PIECE_SYMBOLS), std::tolower(p.front()));
+            auto it = std::find(std::begin(PIECE_SYMBOLS), std::end(PIECE_SYMBOLS), std::tolower(p.back()));
             if (it == std::end(PIECE_SYMBOLS))
             {
                 throw std::invalid_argument("");
@@ -1894,6 +2346,131 @@
         return this->is_castling(move) && square_file(move.to_square) < square_file(move.from_square);
     }
 
+    int Board::see(const Move &move) const
+    {
+        /*
+        Static exchange evaluation. Plays out the sequence of captures on the
+        target square of the given pseudo-legal move, always recapturing with
+        the least valuable attacker, and returns the material balance in
+        centipawns from the point of view of the side to move.
+
+        Sliders that are uncovered as pieces leave the exchange square
+        (x-rays) join the sequence. En passant and promotions are accounted
+        for. Pins are not considered.
+
+        Quiet moves evaluate to ``0`` or less, null moves, drops and castling
+        moves to ``0``.
+        */
+        if (!move || move.drop || this->is_castling(move))
+        {
+            return 0;
+        }
+
+        Square to_square = move.to_square;
+        Bitboard to_bb = BB_SQUARES[to_square];
+        bool backrank = bool(to_bb & (BB_BACKRANKS));
+        Bitboard occupied = this->occupied ^ BB_SQUARES[move.from_square];
+
+        // The swap list: gain[d] is the balance for the side making the d-th
+        // capture, assuming the exchange ends there.
+        int gain[32];
+        int d = 0;
+
+        if (this->is_en_passant(move))
+        {
+            gain[0] = PIECE_VALUES[PAWN];
+            occupied ^= BB_SQUARES[to_square + (this->turn == WHITE ? -8 : 8)];
+        }
+        else
+        {
+            gain[0] = PIECE_VALUES[this->piece_type_at(to_square).value_or(0)];
+        }
+
+        // The value of the piece currently standing on the target square.
+        int on_square = PIECE_VALUES[this->piece_type_at(move.from_square).value_or(0)];
+        if (move.promotion)
+        {
+            gain[0] += PIECE_VALUES[*move.promotion] - PIECE_VALUES[PAWN];
+            on_square = PIECE_VALUES[*move.promotion];
+        }
+
+        Color color = !this->turn;
+        while (d < 31)
+        {
+            // Recompute with the current occupancy to reveal x-ray attackers.
+            Bitboard attackers = this->_attackers_mask(color, to_square, occupied) & occupied;
+            if (!attackers)
+            {
+                break;
+            }
+
+            PieceType piece_type;
+            Bitboard from_bb = this->_least_valuable_attacker(attackers, piece_type);
+
+            // The king may only recapture if the square is no longer defended.
+            if (piece_type == KING && this->_attackers_mask(!color, to_square, occupied ^ from_bb) & occupied)
+            {
+                break;
+            }
+
+            ++d;
+            gain[d] = on_square - gain[d - 1];
+            on_square = PIECE_VALUES[piece_type];
+            if (piece_type == PAWN && backrank)
+            {
+                gain[d] += PIECE_VALUES[QUEEN] - PIECE_VALUES[PAWN];
+                on_square = PIECE_VALUES[QUEEN];
+            }
+
+            occupied ^= from_bb;
+            color = !color;
+        }
+
+        while (d)
+        {
+            gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+            --d;
+        }
+
+        return gain[0];
+    }
+
+    bool Board::see_ge(const Move &move, int threshold) const
+    {
+        /*
+        Tests if the static exchange evaluation of the given pseudo-legal move
+        is at least *threshold*. Cheaper than :func:`~Board::see()` when the
+        outcome is decided by the first capture alone.
+        */
+        if (!move || move.drop || this->is_castling(move))
+        {
+            return 0 >= threshold;
+        }
+
+        int captured = this->is_en_passant(move) ? PIECE_VALUES[PAWN] : PIECE_VALUES[this->piece_type_at(move.to_square).value_or(0)];
+        int on_square = PIECE_VALUES[this->piece_type_at(move.from_square).value_or(0)];
+        if (move.promotion)
+        {
+            captured += PIECE_VALUES[*move.promotion] - PIECE_VALUES[PAWN];
+            on_square = PIECE_VALUES[*move.promotion];
+        }
+
+        // Even an unanswered capture does not reach the threshold.
+        if (captured < threshold)
+        {
+            return false;
+        }
+
+        // Even losing the capturing piece keeps us above the threshold
+        // (unless a recapturing pawn could promote).
+        if (captured - on_square >= threshold && !(BB_SQUARES[move.to_square] & (BB_BACKRANKS)))
+        {
+            return true;
+        }
+
+        return this->see(move) >= threshold;
+    }
+
     Bitboard Board::clean_castling_rights() const
     {
         /*
@@ -2271,25 +2848,9 @@
             return iter;
         }
 
-        Bitboard bb_c = BB_FILE_C & backrank;
-        Bitboard bb_d = BB_FILE_D & backrank;
-        Bitboard bb_f = BB_FILE_F & backrank;
-        Bitboard bb_g = BB_FILE_G & backrank;
-
         for (Square candidate : scan_reversed(this->clean_castling_rights() & backrank & to_mask))
         {
-            Bitboard rook = BB_SQUARES[candidate];
-
-            bool a_side = rook < king;
-            Bitboard king_to = a_side ? bb_c : bb_g;
-            Bitboard rook_to = a_side ? bb_d : bb_f;
-
-            Bitboard king_path = between(msb(king), msb(king_to));
-            Bitboard rook_path = between(candidate, msb(rook_to));
-
-            if (!((this->occupied ^ king ^ rook) & (king_path | rook_path | king_to | rook_to) ||
-                  this->_attacked_for_king(king_path | king, this->occupied ^ king) ||
-                  this->_attacked_for_king(king_to, this->occupied ^ king ^ rook ^ rook_to)))
+            if (this->_can_castle(king, candidate))
             {
                 iter.push_back(this->_from_chess960(this->chess960, msb(king), candidate));
             }
@@ -2297,6 +2858,27 @@
         return iter;
     }
 
+    bool Board::_can_castle(Bitboard king, Square candidate) const
+    {
+        // Whether the *king* of the side to move, on its backrank, can castle
+        // with the rook on *candidate*: the squares the king and the rook
+        // pass and end on are empty but for them, and the king passes no
+        // attacked square.
+        Bitboard backrank = this->turn == WHITE ? BB_RANK_1 : BB_RANK_8;
+        Bitboard rook = BB_SQUARES[candidate];
+
+        bool a_side = rook < king;
+        Bitboard king_to = (a_side ? BB_FILE_C : BB_FILE_G) & backrank;
+        Bitboard rook_to = (a_side ? BB_FILE_D : BB_FILE_F) & backrank;
+
+        Bitboard king_path = between(msb(king), msb(king_to));
+        Bitboard rook_path = between(candidate, msb(rook_to));
+
+        return !((this->occupied ^ king ^ rook) & (king_path | rook_path | king_to | rook_to) ||
+                 this->_attacked_for_king(king_path | king, this->occupied ^ king) ||
+                 this->_attacked_for_king(king_to, this->occupied ^ king ^ rook ^ rook_to));
+    }
+
     bool Board::operator==(const Board &board) const
     {
         return (
@@ -2327,6 +2909,14 @@
         board.occupied_co[BLACK] = this->occupied_co[BLACK];
         board.occupied = this->occupied;
         board.promoted = this->promoted;
+        board.pawn_key = this->pawn_key;
+        board.piece_key = this->piece_key;
+        board.polyglot_piece_key = this->polyglot_piece_key;
+        board.material_key = this->material_key;
+        board.non_pawn_material[WHITE] = this->non_pawn_material[WHITE];
+        board.non_pawn_material[BLACK] = this->non_pawn_material[BLACK];
+        std::copy(&this->piece_count[0][0], &this->piece_count[0][0] + 14, &board.piece_count[0][0]);
+        board.psq = this->psq;
 
         board.ep_square = this->ep_square;
         board.castling_rights = this->castling_rights;
@@ -2380,7 +2970,7 @@
             return;
         }
 
-        if (!regex_match(castling_fen, FEN_CASTLING_REGEX))
+        if (!_is_castling_fen(castling_fen))
         {
             throw std::invalid_argument("invalid castling fen: \"" + castling_fen + "\"");
         }
@@ -2992,9 +3582,9 @@
 
         Bitboard blockers = 0;
 
-        for (Square sniper : scan_reversed(snipers & this->occupied_co[!this->turn]))
+        for (Bitboard bb = snipers & this->occupied_co[!this->turn]; bb; bb &= bb - 1)
         {
-            Bitboard b = between(king, sniper) & this->occupied;
+            Bitboard b = between(king, lsb(bb)) & this->occupied;
 
             // Add to blockers if exactly one piece in-between.
             if (b && BB_SQUARES[msb(b)] == b)
@@ -3006,6 +3596,22 @@
         return blockers & this->occupied_co[this->turn];
     }
 
+    Bitboard Board::_least_valuable_attacker(Bitboard attackers, PieceType &piece_type) const
+    {
+        const Bitboard by_type[] = {this->pawns, this->knights, this->bishops, this->rooks, this->queens, this->kings};
+        for (PieceType pt : PIECE_TYPES)
+        {
+            Bitboard bb = attackers & by_type[pt - 1];
+            if (bb)
+            {
+                piece_type = pt;
+                return bb & -bb;
+            }
+        }
+        piece_type = 0;
+        return BB_EMPTY;
+    }
+
     bool Board::_is_safe(Square king, Bitboard blockers, const Move &move) const
     {
         if (move.from_square == king)
@@ -3078,11 +3684,45 @@
         return iter;
     }
 
+    bool Board::_is_evasion(Square king, Bitboard checkers, const Move &move) const
+    {
+        // Whether the pseudo-legal *move* is among the moves
+        // _generate_evasions() yields, without generating them.
+        if (move.from_square == king)
+        {
+            if (this->is_castling(move))
+            {
+                return false;
+            }
+            // The king cannot step back along the line of a slider checker.
+            Bitboard attacked = 0;
+            for (Bitboard sliders = checkers & (this->bishops | this->rooks | this->queens); sliders; sliders &= sliders - 1)
+            {
+                attacked |= ray(king, lsb(sliders)) & ~BB_SQUARES[lsb(sliders)];
+            }
+            return !(attacked & BB_SQUARES[move.to_square]);
+        }
+
+        // Capture or block a single checker, or capture the checking pawn
+        // en passant.
+        Square checker = msb(checkers);
+        if (BB_SQUARES[checker] != checkers)
+        {
+            return false;
+        }
+        Bitboard target = between(king, checker) | checkers;
+        if (target & BB_SQUARES[move.to_square])
+        {
+            return true;
+        }
+        return this->is_en_passant(move) && *this->ep_square + (this->turn == WHITE ? -8 : 8) == checker;
+    }
+
     bool Board::_attacked_for_king(Bitboard path, Bitboard occupied) const
     {
-        for (Square sq : scan_reversed(path))
+        for (; path; path &= path - 1)
         {
-            if (this->_attackers_mask(!this->turn, sq, occupied))
+            if (this->_attackers_mask(!this->turn, lsb(path), occupied))
             {
                 return true;
             }
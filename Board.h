@@ -8,10 +8,16 @@
 
     public:
         Bitboard pawns, knights, bishops, rooks, queens, kings, occupied_w, occupied_b, occupied, promoted;
+        Bitboard pawn_key, piece_key, polyglot_piece_key, material_key;
+        int non_pawn_material[2];
+        int piece_count[2][7];
+        Score psq;
         Color turn;
         Bitboard castling_rights;
         std::optional<Square> ep_square;
         int halfmove_clock, fullmove_number;
+        DirtyPieces dirty_pieces;
+        /* The pieces the move pushed from this state changed. */
         _BoardState(const Board &);
 
         void restore(Board &) const;
@@ -187,6 +193,10 @@
 
         Move peek() const;
 
+        Bitboard zobrist_key() const;
+
+        Bitboard polyglot_key() const;
+
         Move find_move(Square, Square, std::optional<PieceType> = std::nullopt);
 
         std::string castling_shredder_fen() const;
@@ -251,6 +261,10 @@
 
         bool is_queenside_castling(const Move &) const;
 
+        int see(const Move &) const;
+
+        bool see_ge(const Move &, int = 0) const;
+
         Bitboard clean_castling_rights() const;
 
         bool has_castling_rights(Color) const;
@@ -283,6 +297,19 @@
         void apply_mirror();
 
         Board mirror() const;
+
+        const std::vector<_BoardState> &states() const;
+
+        static const size_t PACKED_SIZE = 32;
+        /* The size of a board packed by :func:`Board::pack()`. */
+
+        void pack(uint8_t *) const;
+
+        void unpack(const uint8_t *);
+
+        int encode_move(const Move &) const;
+
+        Move decode_move(int) const;
     private:
         std::vector<_BoardState> _stack;
 
@@ -312,10 +339,16 @@
 
         Bitboard _slider_blockers(Square) const;
 
+        Bitboard _least_valuable_attacker(Bitboard, PieceType &) const;
+
         bool _is_safe(Square, Bitboard, const Move &) const;
 
         std::vector<Move> _generate_evasions(Square, Bitboard, Bitboard = BB_ALL, Bitboard = BB_ALL) const;
 
+        bool _is_evasion(Square, Bitboard, const Move &) const;
+
+        bool _can_castle(Bitboard, Square) const;
+
         bool _attacked_for_king(Bitboard, Bitboard) const;
 
         Move _from_chess960(bool, Square, Square, std::optional<PieceType> = std::nullopt, std::optional<PieceType> = std::nullopt) const;
@@ -325,4 +358,10 @@
         std::tuple<Bitboard, Bitboard, Bitboard, Bitboard, Bitboard, Bitboard, Bitboard, Bitboard, Color, Bitboard, Square> _transposition_key() const;
     };
     std::ostream &operator<<(std::ostream &, Board);
+
+    void pack_boards(const Board *, size_t, uint8_t *);
+
+    bool unpack_pieces(const uint8_t *, Bitboard *);
+
+    void unpack_boards(const uint8_t *, size_t, Board *);
 #endif // BOARD_H
@@ -37,9 +37,18 @@
         static Move from_uci(const std::string &);
 
         static Move null();
+
+        bool operator==(const Move& m) const
+        {return m.from_square==this->from_square&&m.to_square==this->to_square&&m.promotion==this->promotion&&m.drop==this->drop;}
     };
 
     std::ostream &operator<<(std::ostream &, const Move &);
+    const int RAW_MOVE_EN_PASSANT = 5 << 12;
+    /* Flag of a raw move set by :func:`Board::encode_move()` for en passant captures. */
+
+    const int RAW_MOVE_CASTLING = 6 << 12;
+    /* Flag of a raw move set by :func:`Board::encode_move()` for castling, stored as the king capturing its rook. */
+
     int encode_raw_move(Move);
     Move decode_raw_move(int);
 #endif // MOVE_H_INCLUDED
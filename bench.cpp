@@ -0,0 +1,1096 @@
+#include "bench.h"
+#include "thread.h"
+#include "pawns.h"
+#include "material.h"
+#include "gamefile.h"
+#include "polyglot.h"
+#include "explorer.h"
+#include "trainfeatures.h"
+#include "selfplay.h"
+#include "fenbatch.h"
+#include "parallel.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <unordered_set>
+
+    const std::vector<std::string> BENCH_FENS = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+        "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+        "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+        "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+        "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+        "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+        "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+        "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+        "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+        "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+        "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+        "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+        "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+        "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+        "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+        "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+        "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+        "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+        "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+        "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+        "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+        "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+        "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+        "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+        "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+        "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+        "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+        "4k3/8/8/8/3pP3/8/8/4K3 b - e3 0 1",
+        "1k6/5P2/8/8/8/8/8/4K3 w - - 0 1",
+    };
+
+    void bench_see()
+    {
+        /*
+        Measures the per-call cost of :func:`~Board::see()` and
+        :func:`~Board::see_ge()` over all captures and promotions in the
+        benchmark positions.
+        */
+        std::vector<std::pair<Board, std::vector<Move>>> cases;
+        size_t moves = 0;
+        for (const std::string &fen : BENCH_FENS)
+        {
+            Board board(fen);
+            std::vector<Move> captures;
+            for (const Move &move : board.generate_legal_moves())
+            {
+                if (board.is_capture(move) || move.promotion)
+                {
+                    captures.push_back(move);
+                }
+            }
+            moves += captures.size();
+            cases.emplace_back(board, captures);
+        }
+
+        const int iterations = 2000;
+        long long checksum = 0;
+
+        auto ts = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            for (const auto &[board, captures] : cases)
+            {
+                for (const Move &move : captures)
+                {
+                    checksum += board.see(move);
+                }
+            }
+        }
+        auto te = std::chrono::steady_clock::now();
+        double see_ns = std::chrono::duration<double, std::nano>(te - ts).count() / (double(iterations) * moves);
+
+        ts = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            for (const auto &[board, captures] : cases)
+            {
+                for (const Move &move : captures)
+                {
+                    checksum += board.see_ge(move);
+                }
+            }
+        }
+        te = std::chrono::steady_clock::now();
+        double see_ge_ns = std::chrono::duration<double, std::nano>(te - ts).count() / (double(iterations) * moves);
+
+        std::cout << "SEE: " << moves << " captures in " << cases.size() << " positions, checksum " << checksum << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "see()    " << see_ns << " ns/call" << std::endl;
+        std::cout << "see_ge() " << see_ge_ns << " ns/call" << std::endl;
+    }
+
+    void bench_search(int depth, const SearchOptions &options)
+    {
+        /*
+        Searches the benchmark positions to a fixed depth and reports nodes,
+        time and the share of cutoffs produced by the first move, which
+        measures move ordering quality. Also reports the time to reach each
+        depth and the effective branching factor, the node growth from one
+        iteration to the next, summed over all positions.
+        */
+        std::unique_ptr<Search> search = std::make_unique<Search>();
+        search->options = options;
+        SearchStats total;
+        double total_s = 0;
+        std::vector<uint64_t> depth_nodes(depth + 1, 0);
+        std::vector<double> depth_s(depth + 1, 0);
+        thread_pawn_table().clear();
+        thread_material_table().clear();
+        thread_eval_cache().clear();
+
+        std::cout << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < BENCH_FENS.size(); ++i)
+        {
+            search->clear();
+            search->board = Board(BENCH_FENS[i]);
+
+            auto ts = std::chrono::steady_clock::now();
+            uint64_t previous_nodes = 0;
+            Value value = search->iterate(depth, [&](int d, Value)
+                                          {
+                                              depth_nodes[d] += search->stats.nodes - previous_nodes;
+                                              previous_nodes = search->stats.nodes;
+                                              depth_s[d] += std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+                                          });
+            auto te = std::chrono::steady_clock::now();
+            double s = std::chrono::duration<double>(te - ts).count();
+
+            std::cout << "Position " << i + 1 << "/" << BENCH_FENS.size()
+                      << " score " << value
+                      << " best " << (search->pv.empty() ? "(none)" : search->pv.front().uci())
+                      << " nodes " << search->stats.nodes
+                      << " time " << s << "s"
+                      << " first-move cutoffs " << search->stats.first_move_cutoff_rate() << std::endl;
+
+            total.nodes += search->stats.nodes;
+            total.qnodes += search->stats.qnodes;
+            total.fail_highs += search->stats.fail_highs;
+            total.fail_highs_first += search->stats.fail_highs_first;
+            total_s += s;
+        }
+
+        std::cout << "===========================" << std::endl;
+        std::cout << "Depth  Nodes         Time-to-depth (s)  EBF" << std::endl;
+        for (int d = 1; d <= depth; ++d)
+        {
+            std::cout << std::setw(5) << d << "  " << std::setw(12) << depth_nodes[d] << "  " << std::setw(17) << depth_s[d] << "  ";
+            if (d > 1 && depth_nodes[d - 1])
+            {
+                std::cout << double(depth_nodes[d]) / depth_nodes[d - 1];
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "===========================" << std::endl;
+        std::cout << "Depth           : " << depth << std::endl;
+        std::cout << "Nodes searched  : " << total.nodes << " (" << total.qnodes << " quiescence)" << std::endl;
+        std::cout << "Total time (s)  : " << total_s << std::endl;
+        std::cout << "Nodes/second    : " << std::setprecision(0) << total.nodes / total_s << std::endl;
+        std::cout << "Average EBF     : " << std::setprecision(3) << std::pow(double(total.nodes) / BENCH_FENS.size(), 1.0 / depth) << std::endl;
+        std::cout << "First-move cutoffs: " << total.first_move_cutoff_rate()
+                  << " (" << total.fail_highs_first << "/" << total.fail_highs << ")" << std::endl;
+        const PawnTable &pawn_table = thread_pawn_table();
+        std::cout << "Pawn table hits: " << pawn_table.hit_rate()
+                  << " (" << pawn_table.hits << "/" << pawn_table.hits + pawn_table.misses << ")" << std::endl;
+        const MaterialTable &material_table = thread_material_table();
+        std::cout << "Material table hits: " << material_table.hit_rate()
+                  << " (" << material_table.hits << "/" << material_table.hits + material_table.misses << ")" << std::endl;
+        const EvalCache &eval_cache = thread_eval_cache();
+        std::cout << "Eval cache hits: " << eval_cache.hit_rate()
+                  << " (" << eval_cache.hits << "/" << eval_cache.hits + eval_cache.misses << ")" << std::endl;
+    }
+
+    void bench_eval(int passes)
+    {
+        /*
+        Measures the throughput of :func:`eval()` on the benchmark positions
+        and every position one move away from them, which resembles the mix
+        of positions seen by the search. The checksum of all scores should
+        only change with changes to the evaluation itself.
+        */
+        std::vector<Board> boards;
+        for (const std::string &fen : BENCH_FENS)
+        {
+            Board board(fen);
+            boards.push_back(board);
+            for (const Move &move : board.generate_legal_moves())
+            {
+                board.push(move);
+                boards.push_back(board);
+                board.pop();
+            }
+        }
+
+        // The checksum is computed without the cache, so it always reflects
+        // the evaluation itself.
+        size_t cache_size = EvalCache::configured_size;
+        EvalCache::configured_size = 0;
+        int64_t checksum = 0;
+        for (const Board &board : boards)
+        {
+            checksum += eval(board);
+        }
+        std::cout << "Eval: " << boards.size() << " positions, " << passes << " passes, checksum " << checksum << std::endl;
+
+        // Once without and once with the evaluation cache. After the first
+        // pass the cached run mostly measures cache hits, like re-scoring a
+        // batch of known positions.
+        std::cout << std::fixed;
+        for (size_t size : {size_t(0), cache_size})
+        {
+            EvalCache::configured_size = size;
+            thread_eval_cache().clear();
+            thread_pawn_table().clear();
+            thread_material_table().clear();
+            auto ts = std::chrono::steady_clock::now();
+            int64_t sink = 0;
+            for (int i = 0; i < passes; ++i)
+            {
+                for (const Board &board : boards)
+                {
+                    sink += eval(board);
+                }
+            }
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+            uint64_t evals = uint64_t(passes) * boards.size();
+
+            std::cout << (size ? "Eval cache " + std::to_string(size) + " MiB" : std::string("No eval cache")) << std::endl;
+            std::cout << std::setprecision(3);
+            std::cout << "Time (s)      : " << s << (sink == checksum * passes ? "" : " (inconsistent results)") << std::endl;
+            std::cout << "Evals/second  : " << std::setprecision(0) << evals / s << std::endl;
+            std::cout << "ns/eval       : " << std::setprecision(1) << s * 1e9 / evals << std::endl;
+            std::cout << "Pawn table hits: " << std::setprecision(3) << thread_pawn_table().hit_rate() << std::endl;
+            std::cout << "Material table hits: " << thread_material_table().hit_rate() << std::endl;
+            if (size)
+            {
+                std::cout << "Eval cache hits: " << thread_eval_cache().hit_rate() << std::endl;
+            }
+        }
+        EvalCache::configured_size = cache_size;
+    }
+
+    static std::string _write_random_network()
+    {
+        /*
+        Writes a network with small random weights to a temporary file and
+        returns its path. It plays badly but costs the same to evaluate as a
+        trained one.
+        */
+        std::string path = (std::filesystem::temp_directory_path() / "cppchess-random.nnue").string();
+        std::ofstream out(path, std::ios::binary);
+        std::mt19937 rng(12345);
+        auto write = [&](auto value, size_t count, int range)
+        {
+            std::uniform_int_distribution<int> distribution(-range, range);
+            for (size_t i = 0; i < count; ++i)
+            {
+                decltype(value) x = distribution(rng);
+                out.write((const char *)&x, sizeof(x));
+            }
+        };
+        const uint32_t header[8] = {NNUE_MAGIC, NNUE_VERSION, NNUE_FEATURES, NNUE_HIDDEN, NNUE_L2, NNUE_L3, 0, 0};
+        out.write((const char *)header, sizeof(header));
+        write(int16_t(), NNUE_HIDDEN, 32);
+        write(int16_t(), size_t(NNUE_FEATURES) * NNUE_HIDDEN, 8);
+        write(int32_t(), NNUE_L2, 256);
+        write(int8_t(), NNUE_L2 * 2 * NNUE_HIDDEN, 8);
+        write(int32_t(), NNUE_L3, 256);
+        write(int8_t(), NNUE_L3 * NNUE_L2, 32);
+        write(int32_t(), 1, 256);
+        write(int8_t(), NNUE_L3, 64);
+        return path;
+    }
+
+    void bench_nnue(int passes, const std::string &path)
+    {
+        /*
+        Compares the throughput of :func:`eval()` and :func:`NNUE::evaluate()`
+        on the benchmark positions and every position two moves away from
+        them, visited with push and pop like the search does. The network
+        evaluates these incrementally; it is also measured with a full
+        refresh of the accumulator for every position.
+
+        Without *path* a random network is used, the speed does not depend
+        on the weights.
+        */
+        Network &net = network();
+        net.load(path.empty() ? _write_random_network() : path);
+        NNUE &nnue = thread_nnue();
+        std::cout << "Network: " << net.path << " (" << NNUE::simd() << ")" << std::endl;
+
+        // Incremental updates must give exactly the scores of a refresh.
+        int64_t checksum = 0;
+        bool consistent = true;
+        for (const std::string &fen : BENCH_FENS)
+        {
+            Board board(fen);
+            for (const Move &move : board.generate_legal_moves())
+            {
+                board.push(move);
+                Value value = nnue.evaluate(board);
+                nnue.clear();
+                consistent &= value == nnue.evaluate(board);
+                checksum += value;
+                board.pop();
+            }
+        }
+        std::cout << "Checksum " << checksum << (consistent ? "" : " (incremental and refreshed scores differ)") << std::endl;
+
+        size_t cache_size = EvalCache::configured_size;
+        EvalCache::configured_size = 0;
+        std::cout << std::fixed;
+        for (const char *evaluator : {"eval()", "NNUE refresh", "NNUE incremental"})
+        {
+            std::string name = evaluator;
+            thread_pawn_table().clear();
+            thread_material_table().clear();
+            nnue.clear();
+            uint64_t evals = 0;
+            int64_t sink = 0;
+            auto evaluate = [&](const Board &board)
+            {
+                if (name == "eval()")
+                {
+                    sink += eval(board);
+                }
+                else
+                {
+                    if (name == "NNUE refresh")
+                    {
+                        nnue.clear();
+                    }
+                    sink += nnue.evaluate(board);
+                }
+                ++evals;
+            };
+
+            auto ts = std::chrono::steady_clock::now();
+            for (int i = 0; i < passes; ++i)
+            {
+                for (const std::string &fen : BENCH_FENS)
+                {
+                    Board board(fen);
+                    evaluate(board);
+                    for (const Move &move : board.generate_legal_moves())
+                    {
+                        board.push(move);
+                        evaluate(board);
+                        for (const Move &reply : board.generate_legal_moves())
+                        {
+                            board.push(reply);
+                            evaluate(board);
+                            board.pop();
+                        }
+                        board.pop();
+                    }
+                }
+            }
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+
+            std::cout << name << std::endl;
+            std::cout << std::setprecision(3);
+            std::cout << "Time (s)      : " << s << " (" << evals << " evals, includes move generation)" << std::endl;
+            std::cout << "Evals/second  : " << std::setprecision(0) << evals / s << std::endl;
+            if (name == "NNUE incremental")
+            {
+                std::cout << "Refreshes     : " << nnue.refreshes << ", updates " << nnue.updates << std::endl;
+            }
+        }
+        EvalCache::configured_size = cache_size;
+        net.unload();
+    }
+
+    void bench_pack(int passes)
+    {
+        /*
+        Compares :func:`Board::pack()` and :func:`Board::unpack()` with
+        :func:`Board::fen()` and :func:`Board::set_fen()` on the benchmark
+        positions and every position one move away from them, and checks
+        that every position survives the round trip.
+        */
+        std::vector<Board> boards;
+        for (const std::string &fen : BENCH_FENS)
+        {
+            Board board(fen);
+            boards.push_back(board);
+            for (const Move &move : board.generate_legal_moves())
+            {
+                board.push(move);
+                boards.push_back(board);
+                boards.back().clear_stack();
+                board.pop();
+            }
+        }
+
+        std::vector<uint8_t> packed(boards.size() * Board::PACKED_SIZE);
+        std::vector<Board> unpacked(boards.size());
+        std::vector<std::string> fens(boards.size());
+        size_t fen_bytes = 0;
+        for (size_t i = 0; i < boards.size(); ++i)
+        {
+            fens[i] = boards[i].fen(false, "fen");
+            fen_bytes += fens[i].size() + 1;
+        }
+        pack_boards(boards.data(), boards.size(), packed.data());
+        unpack_boards(packed.data(), boards.size(), unpacked.data());
+        size_t mismatches = 0;
+        for (size_t i = 0; i < boards.size(); ++i)
+        {
+            mismatches += !(unpacked[i] == boards[i]) || unpacked[i].fen(false, "fen") != fens[i] || !unpacked[i].check_incremental();
+        }
+        std::cout << "Pack: " << boards.size() << " positions, " << mismatches << " round trip mismatches" << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Bytes/position: " << double(Board::PACKED_SIZE) << " packed, " << double(fen_bytes) / boards.size() << " as FEN" << std::endl;
+
+        auto measure = [&](const std::string &name, const std::function<void()> &pass)
+        {
+            auto ts = std::chrono::steady_clock::now();
+            for (int i = 0; i < passes; ++i)
+            {
+                pass();
+            }
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+            std::cout << std::setw(10) << std::left << name << std::right << std::setw(10) << s * 1e9 / (double(passes) * boards.size()) << " ns/position" << std::endl;
+        };
+        measure("fen()", [&]
+                {
+                    for (size_t i = 0; i < boards.size(); ++i)
+                    {
+                        fens[i] = boards[i].fen(false, "fen");
+                    }
+                });
+        measure("set_fen()", [&]
+                {
+                    for (size_t i = 0; i < boards.size(); ++i)
+                    {
+                        unpacked[i].set_fen(fens[i]);
+                    }
+                });
+        measure("pack()", [&]
+                { pack_boards(boards.data(), boards.size(), packed.data()); });
+        measure("unpack()", [&]
+                { unpack_boards(packed.data(), boards.size(), unpacked.data()); });
+    }
+
+    void bench_features(int passes)
+    {
+        /*
+        Times the batch feature exports on the benchmark positions and every
+        position one move away from them, from boards and from packed
+        positions, against a loop over the squares with
+        :func:`~BaseBoard::piece_at()`, and checks that all agree.
+        */
+        std::vector<Board> boards;
+        for (const std::string &fen : BENCH_FENS)
+        {
+            Board board(fen);
+            boards.push_back(board);
+            for (const Move &move : board.generate_legal_moves())
+            {
+                board.push(move);
+                boards.push_back(board);
+                boards.back().clear_stack();
+                board.pop();
+            }
+        }
+        size_t n = boards.size();
+        std::vector<uint8_t> packed(n * Board::PACKED_SIZE);
+        pack_boards(boards.data(), n, packed.data());
+
+        std::vector<uint8_t> reference(n * BITPLANES_SIZE), planes(n * BITPLANES_SIZE), packed_planes(n * BITPLANES_SIZE);
+        std::vector<float> float_planes(n * BITPLANES_SIZE);
+        std::vector<int32_t> features(n * 2 * HALFKP_SLOTS), packed_features(n * 2 * HALFKP_SLOTS);
+        auto loop = [&]
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (Square square = 0; square < 64; ++square)
+                {
+                    for (int plane = 0; plane < BITPLANES; ++plane)
+                    {
+                        reference[i * BITPLANES_SIZE + plane * 64 + square] = 0;
+                    }
+                    std::optional<Piece> piece = boards[i].piece_at(square);
+                    if (piece)
+                    {
+                        reference[i * BITPLANES_SIZE + ((piece->color == WHITE ? 0 : 6) + piece->piece_type - 1) * 64 + square] = 1;
+                    }
+                }
+            }
+        };
+
+        std::cout << "Features: " << n << " positions, " << features_simd() << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        auto measure = [&](const std::string &name, const std::function<void()> &pass)
+        {
+            auto ts = std::chrono::steady_clock::now();
+            for (int i = 0; i < passes; ++i)
+            {
+                pass();
+            }
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+            std::cout << std::setw(24) << std::left << name << std::right << std::setw(8) << s * 1e9 / (double(passes) * n) << " ns/position, "
+                      << std::setw(6) << double(passes) * n / s / 1e6 << " M positions/s" << std::endl;
+        };
+        measure("piece_at() loop", loop);
+        measure("bitplanes() uint8", [&]
+                { bitplanes(boards.data(), n, planes.data()); });
+        measure("bitplanes() float", [&]
+                { bitplanes(boards.data(), n, float_planes.data()); });
+        measure("packed_bitplanes() uint8", [&]
+                { packed_bitplanes(packed.data(), n, packed_planes.data()); });
+        size_t active = 0;
+        measure("halfkp_features()", [&]
+                { active = halfkp_features(boards.data(), n, features.data()); });
+        measure("packed_halfkp_features()", [&]
+                { packed_halfkp_features(packed.data(), n, packed_features.data()); });
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            mismatches += planes[i] != reference[i] || packed_planes[i] != reference[i] || float_planes[i] != reference[i];
+        }
+        mismatches += features != packed_features;
+        std::cout << "Mismatches: " << mismatches << ", " << double(active) / n << " active features per position" << std::endl;
+    }
+
+    static void _opening_positions(const std::string &pgn_path, int plies, std::vector<Board> &boards, std::vector<Move> &moves)
+    {
+        // The positions of the first *plies* of the games in the PGN file
+        // at *pgn_path*, and the moves played in them.
+        read_pgn_file(pgn_path, [&](const PgnGame &game)
+                      {
+                          Board board = game.board;
+                          while (!board.move_stack.empty())
+                          {
+                              board.pop();
+                          }
+                          for (size_t ply = 0; ply < game.moves.size() && ply < size_t(plies); ++ply)
+                          {
+                              boards.push_back(board);
+                              boards.back().clear_stack();
+                              moves.push_back(game.moves[ply]);
+                              board.push(game.moves[ply]);
+                          }
+                          return true;
+                      });
+    }
+
+    void bench_book(const std::string &pgn_path, const std::string &book_path, int plies)
+    {
+        /*
+        Probes a Polyglot book with the positions of the first *plies* of
+        the games in the PGN file at *pgn_path*. Without *book_path* a book
+        counting the moves played in those positions is written to a
+        temporary file first, and every move must be found in it.
+
+        Also checks :func:`Board::polyglot_key()` against the keys of the
+        Polyglot specification.
+        */
+        static const std::pair<std::string, Bitboard> key_tests[] = {
+            {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463b96181691fc9c},
+            {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196},
+            {"rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756b94461c50fb0},
+            {"rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662fafb965db29d4},
+            {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22a48b5a8e47ff78},
+            {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652a607ca3f242c1},
+            {"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00fdd303c946bdd9},
+            {"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3c8123ea7b067637},
+            {"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5c3f9b829b279560}};
+        size_t key_failures = 0;
+        for (const auto &[fen, key] : key_tests)
+        {
+            key_failures += Board(fen).polyglot_key() != key;
+        }
+        std::cout << "Key tests     : " << std::size(key_tests) - key_failures << "/" << std::size(key_tests) << " passed" << std::endl;
+
+        std::vector<Board> boards;
+        std::vector<Move> moves;
+        _opening_positions(pgn_path, plies, boards, moves);
+
+        std::string path = book_path;
+        if (path.empty())
+        {
+            std::map<std::pair<Bitboard, uint16_t>, uint32_t> counts;
+            for (size_t i = 0; i < boards.size(); ++i)
+            {
+                ++counts[{boards[i].polyglot_key(), polyglot_move(boards[i], moves[i])}];
+            }
+            path = (std::filesystem::temp_directory_path() / "cppchess-bench.bin").string();
+            std::ofstream out(path, std::ios::binary);
+            uint8_t data[POLYGLOT_ENTRY_SIZE];
+            for (const auto &[key_move, count] : counts)
+            {
+                PolyglotEntry entry;
+                entry.key = key_move.first;
+                entry.raw_move = key_move.second;
+                entry.weight = std::min<uint32_t>(count, 0xFFFF);
+                write_polyglot_entry(data, entry);
+                out.write((const char *)data, POLYGLOT_ENTRY_SIZE);
+            }
+        }
+
+        PolyglotBook book(path);
+        PolyglotEntry entries[256];
+        size_t hits = 0, found = 0, total_entries = 0;
+        auto ts = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < boards.size(); ++i)
+        {
+            size_t count = book.find_all(boards[i], entries, std::size(entries));
+            hits += count > 0;
+            total_entries += count;
+            for (size_t j = 0; j < count; ++j)
+            {
+                found += entries[j].move == moves[i];
+            }
+        }
+        double find_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+
+        // Weighted choices from all hardware threads at once on the same book.
+        size_t threads = worker_threads(0);
+        std::vector<std::thread> workers;
+        std::atomic<size_t> choices = 0;
+        ts = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]
+                                 {
+                                     std::mt19937_64 random(t);
+                                     size_t chosen = 0;
+                                     for (size_t i = t; i < boards.size(); i += threads)
+                                     {
+                                         chosen += bool(book.choice(boards[i], random()));
+                                     }
+                                     choices += chosen;
+                                 });
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        double choice_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Book          : " << book.size() << " entries" << (book_path.empty() ? " (built from the PGN)" : "") << std::endl;
+        std::cout << "Positions     : " << boards.size() << ", " << hits << " in the book, " << double(total_entries) / std::max<size_t>(hits, 1) << " moves each" << std::endl;
+        std::cout << "Played moves  : " << found << " found" << std::endl;
+        std::cout << "find_all (ns) : " << find_s * 1e9 / boards.size() << " per probe" << std::endl;
+        std::cout << "choice (ns)   : " << choice_s * 1e9 / boards.size() << " per probe on " << threads << " threads, " << choices << " chosen" << std::endl;
+        if (book_path.empty())
+        {
+            book.close();
+            std::filesystem::remove(path);
+        }
+    }
+
+    void bench_book_build(const std::string &pgn_path, size_t threads, int plies)
+    {
+        /*
+        Builds a Polyglot book from the first *plies* of the games in the
+        PGN file at *pgn_path* on *threads* threads, once in memory and once
+        with a memory limit small enough to spill sorted runs to disk, and
+        checks that both books are the same.
+        */
+        std::filesystem::path directory = std::filesystem::temp_directory_path();
+        std::string path = (directory / "cppchess-bench.bin").string();
+        std::string spilled_path = (directory / "cppchess-bench-spilled.bin").string();
+
+        PolyglotBuildOptions options;
+        options.threads = threads;
+        options.plies = plies;
+        PolyglotBuildStats stats = build_polyglot_book(pgn_path, path, options);
+        options.max_memory = std::max<size_t>(stats.entries * 10, 1 << 16);
+        PolyglotBuildStats spilled = build_polyglot_book(pgn_path, spilled_path, options);
+
+        MappedFile book(path), spilled_book(spilled_path);
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Games         : " << stats.pgn.games << " (" << stats.pgn.errors << " with errors), " << stats.positions << " positions" << std::endl;
+        std::cout << "Entries       : " << stats.entries << std::endl;
+        for (const PolyglotBuildStats *s : {&stats, &spilled})
+        {
+            std::cout << (s == &stats ? "In memory (s) : " : "Spilled (s)   : ") << s->seconds << " (" << s->merge_seconds << " merging), " << s->runs << " runs, "
+                      << std::setprecision(1) << s->spilled_bytes / 1048576.0 << " MB spilled, "
+                      << std::setprecision(0) << s->pgn.games / s->seconds << " games/s, " << s->positions / s->seconds << " positions/s" << std::setprecision(3) << std::endl;
+        }
+        std::cout << "Same book     : " << (book.view() == spilled_book.view() ? "yes" : "NO") << std::endl;
+        book.close();
+        spilled_book.close();
+        std::filesystem::remove(path);
+        std::filesystem::remove(spilled_path);
+    }
+
+    void bench_explorer(const std::string &pgn_path, int plies)
+    {
+        /*
+        Builds an explorer index from the first *plies* of the games in the
+        PGN file at *pgn_path* and queries it with every position of those
+        plies. Every played move must be found, and the games of the moves
+        of the starting position must add up to all games.
+        */
+        std::string path = (std::filesystem::temp_directory_path() / "cppchess-bench.explorer").string();
+        MoveCountOptions options;
+        options.plies = plies;
+        MoveCountStats stats = build_explorer_index(pgn_path, path, options);
+
+        std::vector<Board> boards;
+        std::vector<Move> moves;
+        _opening_positions(pgn_path, plies, boards, moves);
+
+        ExplorerIndex index(path);
+        ExplorerMove results[256];
+        size_t found = 0, total_moves = 0;
+        auto ts = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < boards.size(); ++i)
+        {
+            size_t count = index.query(boards[i], results, std::size(results));
+            total_moves += count;
+            for (size_t j = 0; j < count; ++j)
+            {
+                found += results[j].move == moves[i];
+            }
+        }
+        double query_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+
+        uint64_t start_games = 0;
+        size_t count = index.query(Board(), results, std::size(results));
+        for (size_t j = 0; j < count; ++j)
+        {
+            start_games += results[j].games;
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Games         : " << stats.pgn.games << ", " << stats.positions << " positions" << std::endl;
+        std::cout << "Index         : " << index.size() << " records, " << std::filesystem::file_size(path) / 1048576.0 << " MB" << std::endl;
+        std::cout << "Build (s)     : " << stats.seconds << " (" << stats.merge_seconds << " merging), " << std::setprecision(0) << stats.positions / stats.seconds << " positions/s" << std::endl;
+        std::cout << "Queries       : " << boards.size() << ", " << found << " played moves found, " << std::setprecision(1) << double(total_moves) / boards.size() << " moves each" << std::endl;
+        std::cout << std::setprecision(3);
+        std::cout << "Query (us)    : " << query_s * 1e6 / boards.size() << std::endl;
+        std::cout << "Start games   : " << start_games << (start_games == stats.pgn.games ? " (all)" : " (MISSING)") << std::endl;
+        if (count)
+        {
+            std::cout << "Top move      : " << results[0].move.uci() << " " << results[0].games << " games, +" << results[0].white << " =" << results[0].draws << " -" << results[0].black << std::endl;
+        }
+        index.close();
+        std::filesystem::remove(path);
+    }
+
+    void bench_selfplay(int games, size_t threads, uint64_t nodes)
+    {
+        /*
+        Generates *games* self-play games at *nodes* nodes per move on
+        *threads* threads, in two runs: the second resumes the file of the
+        first after garbage was appended to it, as an interrupted write
+        would leave. Then reads the file back and checks that every best
+        move is legal and no position is repeated.
+        */
+        std::string path = (std::filesystem::temp_directory_path() / "cppchess-bench.selfplay").string();
+        std::filesystem::remove(path);
+        SelfPlayOptions options;
+        options.games = games / 2;
+        options.threads = threads;
+        options.nodes = nodes;
+        options.flush_games = 8;
+        SelfPlayStats first = generate_selfplay(path, options);
+        {
+            std::ofstream garbage(path, std::ios::binary | std::ios::app);
+            garbage << "interrupted";
+        }
+        options.games = games;
+        SelfPlayStats stats = generate_selfplay(path, options, [](const SelfPlayStats &progress)
+                                                { std::cout << "Flushed       : " << progress.resumed_games + progress.games << " games, " << progress.resumed_positions + progress.positions << " positions" << std::endl; });
+
+        std::vector<SelfPlayPosition> positions = read_selfplay(path);
+        std::unordered_set<Bitboard> keys;
+        size_t illegal = 0, repeated = 0, wins = 0, losses = 0;
+        Board board;
+        for (const SelfPlayPosition &position : positions)
+        {
+            board.unpack(position.board);
+            illegal += !board.is_legal(board.decode_move(position.move));
+            repeated += !keys.insert(board.zobrist_key()).second;
+            wins += position.result > 0;
+            losses += position.result < 0;
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "First run     : " << first.games << " games, " << first.positions << " positions" << std::endl;
+        std::cout << "Resumed       : " << stats.resumed_games << " games, " << stats.resumed_positions << " positions" << std::endl;
+        std::cout << "Second run    : " << stats.games << " games (+" << stats.white << " =" << stats.draws << " -" << stats.black << "), "
+                  << stats.positions << " positions, " << stats.duplicates << " duplicates" << std::endl;
+        std::cout << "Throughput    : " << stats.games_per_hour() << " games/h, " << stats.positions_per_second() << " positions/s, "
+                  << std::setprecision(0) << stats.nodes / stats.seconds << " nodes/s" << std::endl;
+        std::cout << "File          : " << positions.size() << " positions, " << std::filesystem::file_size(path) << " bytes" << std::endl;
+        std::cout << "Check         : " << illegal << " illegal moves, " << repeated << " repeated positions, "
+                  << wins << " wins = " << losses << " losses" << std::endl;
+        std::filesystem::remove(path);
+    }
+
+    void bench_fen_batch(int lines, size_t threads)
+    {
+        /*
+        Answers *lines* FENs of random games with :func:`run_fen_batch()` on
+        *threads* threads, first the legal move count alone, then all
+        queries, and checks the counts against a plain loop over the FENs.
+        */
+        std::mt19937_64 random(1);
+        std::vector<std::string> fens;
+        Board board;
+        while (int(fens.size()) < lines)
+        {
+            std::vector<Move> moves = board.generate_legal_moves();
+            if (moves.empty() || board.ply() > 200)
+            {
+                board.reset();
+                continue;
+            }
+            board.push(moves[random() % moves.size()]);
+            fens.push_back(board.fen());
+        }
+        std::string text;
+        for (const std::string &fen : fens)
+        {
+            text += fen;
+            text += '\n';
+        }
+
+        std::vector<size_t> expected;
+        auto ts = std::chrono::steady_clock::now();
+        for (const std::string &fen : fens)
+        {
+            board.set_fen(fen);
+            expected.push_back(board.generate_legal_moves().size());
+        }
+        double loop_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+
+        FenBatchOptions options;
+        options.threads = threads;
+        std::istringstream in(text);
+        std::ostringstream out;
+        FenBatchStats stats = run_fen_batch(in, out, options);
+        std::istringstream answers(out.str());
+        size_t mismatches = 0, answered = 0;
+        for (std::string line; std::getline(answers, line); ++answered)
+        {
+            mismatches += answered >= expected.size() || line != std::to_string(expected[answered]);
+        }
+
+        options.queries = {FEN_QUERY_LEGAL, FEN_QUERY_CHECK, FEN_QUERY_RESULT, FEN_QUERY_EVAL, FEN_QUERY_SAN};
+        std::istringstream all_in(text + fens[0] + " moves " + Board(fens[0]).generate_legal_moves()[0].uci() + "\n" + "8/8/8/8/8/8/8/8 w - - 0 1\n");
+        std::ostringstream all_out;
+        FenBatchStats all_stats = run_fen_batch(all_in, all_out, options);
+        std::string all_text = all_out.str();
+        size_t last = all_text.rfind('\n', all_text.size() - 2);
+        size_t before_last = all_text.rfind('\n', last - 1);
+
+        std::cout << std::fixed << std::setprecision(0);
+        std::cout << "Input         : " << lines << " FENs, " << std::setprecision(1) << text.size() / 1048576.0 << " MB" << std::endl;
+        std::cout << std::setprecision(0);
+        std::cout << "Plain loop    : " << fens.size() / loop_s << " FENs/s" << std::endl;
+        std::cout << "Legal moves   : " << stats.lines_per_second() << " FENs/s, " << answered << " answers, " << mismatches << " mismatches" << std::endl;
+        std::cout << "All queries   : " << all_stats.lines_per_second() << " FENs/s, " << all_stats.errors << " errors" << std::endl;
+        std::cout << "Moves line    : " << all_text.substr(before_last + 1, last - before_last - 1) << std::endl;
+        std::cout << "Invalid line  : " << all_text.substr(last + 1, all_text.size() - last - 2) << std::endl;
+    }
+
+    void bench_games(const std::string &pgn_path, bool move_indices)
+    {
+        /*
+        Converts the PGN file at *pgn_path* to a game file and back, and
+        compares the sizes and the time to replay all games from either.
+        With *move_indices* moves are stored as indices into the legal
+        moves.
+        */
+        std::filesystem::path directory = std::filesystem::temp_directory_path();
+        std::string path = (directory / "cppchess-bench.games").string();
+        std::string pgn_copy = (directory / "cppchess-bench.pgn").string();
+        std::string path_copy = (directory / "cppchess-bench-copy.games").string();
+
+        auto ts = std::chrono::steady_clock::now();
+        PgnStats pgn_stats = pgn_to_games(pgn_path, path, move_indices);
+        double convert_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+        ts = std::chrono::steady_clock::now();
+        games_to_pgn(path, pgn_copy);
+        double back_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+
+        // Replaying the games of the game file, once to warm the file cache.
+        uint64_t plies = 0;
+        double replay_s = 0;
+        uint64_t games = 0;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            ts = std::chrono::steady_clock::now();
+            MappedFile file(path, true);
+            GameReader reader(file.view());
+            GameRecord record;
+            Board board;
+            games = plies = 0;
+            while (reader.next(record))
+            {
+                record.replay(board);
+                ++games;
+                plies += record.plies;
+            }
+            replay_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+        }
+        PgnStats pgn_replay = read_pgn_file(pgn_path, [](const PgnGame &)
+                                            { return true; });
+
+        // The converted PGN must convert to the same game file.
+        pgn_to_games(pgn_copy, path_copy, move_indices);
+        MappedFile original(path), copy(path_copy);
+        bool round_trip = original.view() == copy.view();
+
+        uint64_t pgn_bytes = std::filesystem::file_size(pgn_path);
+        uint64_t bytes = std::filesystem::file_size(path);
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Games         : " << games << " (" << pgn_stats.errors << " with errors in the PGN), " << plies << " plies" << std::endl;
+        std::cout << "Moves as      : " << (move_indices ? "legal move indices" : "16 bit codes") << std::endl;
+        std::cout << "Size (MB)     : " << pgn_bytes / 1048576.0 << " PGN, " << bytes / 1048576.0 << " binary (" << std::setprecision(1) << double(pgn_bytes) / bytes << "x smaller)" << std::endl;
+        std::cout << std::setprecision(3);
+        std::cout << "Convert (s)   : " << convert_s << " to binary, " << back_s << " to PGN" << std::endl;
+        std::cout << "Replay (s)    : " << replay_s << " binary, " << pgn_replay.seconds << " PGN" << std::endl;
+        std::cout << std::setprecision(0);
+        std::cout << "Games/second  : " << games / replay_s << " binary, " << pgn_replay.games_per_second() << " PGN" << std::endl;
+        std::cout << "Plies/second  : " << plies / replay_s << " binary, " << pgn_replay.moves / pgn_replay.seconds << " PGN" << std::endl;
+        std::cout << "Round trip    : " << (round_trip ? "identical" : "DIFFERENT") << std::endl;
+        for (const std::string &file : {path, pgn_copy, path_copy})
+        {
+            std::filesystem::remove(file);
+        }
+    }
+
+    void bench_pgn(const std::string &path, size_t threads, bool ordered)
+    {
+        /*
+        Reads the PGN file at *path*, replaying the mainline of every game,
+        and reports the throughput in games and megabytes per second.
+
+        With *threads* the file is read by :func:`read_pgn_parallel()` with
+        that many workers, delivering games in file order if *ordered*.
+        */
+        std::string first_error;
+        uint64_t first_error_game = 0;
+        uint64_t last_offset = 0;
+        bool in_order = true;
+        auto visitor = [&](const PgnGame &game)
+        {
+            if (!game.error.empty() && first_error.empty())
+            {
+                first_error = game.error;
+                first_error_game = game.offset;
+            }
+            in_order &= game.offset >= last_offset;
+            last_offset = game.offset;
+            return true;
+        };
+        PgnPipelineOptions options;
+        options.threads = threads;
+        options.ordered = ordered;
+        PgnStats stats = threads ? read_pgn_file_parallel(path, visitor, options) : read_pgn_file(path, visitor);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Threads       : " << (threads ? std::to_string(threads) + (ordered ? " ordered" : " unordered") : std::string("none")) << std::endl;
+        std::cout << "Games         : " << stats.games << " (" << stats.errors << " with errors, " << (in_order ? "in order" : "out of order") << ")" << std::endl;
+        std::cout << "Moves         : " << stats.moves << std::endl;
+        std::cout << "Size (MB)     : " << stats.bytes / (1024.0 * 1024) << std::endl;
+        std::cout << "Time (s)      : " << stats.seconds << std::endl;
+        std::cout << std::setprecision(0);
+        std::cout << "Games/second  : " << stats.games_per_second() << std::endl;
+        std::cout << "Moves/second  : " << stats.moves / stats.seconds << std::endl;
+        std::cout << std::setprecision(1);
+        std::cout << "MB/second     : " << stats.mb_per_second() << std::endl;
+        if (!first_error.empty())
+        {
+            std::cout << "First error at byte " << first_error_game << ": " << first_error << std::endl;
+        }
+    }
+
+    static void _print_distribution(const std::string &name, std::vector<double> samples)
+    {
+        std::sort(std::begin(samples), std::end(samples));
+        auto percentile = [&](double p)
+        { return samples[std::min(samples.size() - 1, size_t(p * samples.size()))]; };
+        std::cout << std::setw(24) << std::left << name << std::right
+                  << " min " << std::setw(8) << samples.front()
+                  << " p50 " << std::setw(8) << percentile(0.5)
+                  << " p90 " << std::setw(8) << percentile(0.9)
+                  << " p99 " << std::setw(8) << percentile(0.99)
+                  << " max " << std::setw(8) << samples.back() << " ms" << std::endl;
+    }
+
+    void bench_time(int runs)
+    {
+        /*
+        Stress test of the search thread and time manager. Runs *runs*
+        searches per scenario on the benchmark positions and reports the
+        distribution of overshoot: how long after the allotted time (or after
+        :func:`~SearchThread::stop()`) the best move arrived. Also reports how
+        long :func:`~SearchThread::go()` blocks the caller.
+        */
+        SearchThread thread;
+        std::atomic<int64_t> bestmove_us{0};
+        thread.on_bestmove = [&](const Move &, const Move &)
+        { bestmove_us = thread.search().time.elapsed_us(); };
+
+        auto now_us = []
+        { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); };
+
+        std::vector<double> go_latency;
+        std::cout << std::fixed << std::setprecision(2);
+
+        for (int64_t movetime : {20, 50, 100})
+        {
+            std::vector<double> overshoot;
+            for (int i = 0; i < runs; ++i)
+            {
+                SearchLimits limits;
+                limits.movetime = movetime;
+                int64_t ts = now_us();
+                thread.go(Board(BENCH_FENS[i % BENCH_FENS.size()]), limits);
+                go_latency.push_back((now_us() - ts) / 1000.0);
+                thread.wait();
+                overshoot.push_back(bestmove_us / 1000.0 - movetime);
+            }
+            _print_distribution("movetime " + std::to_string(movetime), overshoot);
+        }
+
+        for (int64_t clock : {1000, 10000})
+        {
+            std::vector<double> overshoot;
+            for (int i = 0; i < runs; ++i)
+            {
+                SearchLimits limits;
+                limits.time[WHITE] = limits.time[BLACK] = clock;
+                limits.inc[WHITE] = limits.inc[BLACK] = clock / 100;
+                thread.go(Board(BENCH_FENS[i % BENCH_FENS.size()]), limits);
+                thread.wait();
+                overshoot.push_back((bestmove_us - thread.search().time.hard_limit * 1000) / 1000.0);
+            }
+            _print_distribution("clock " + std::to_string(clock) + " vs hard limit", overshoot);
+        }
+
+        std::vector<double> stop_latency;
+        for (int i = 0; i < runs; ++i)
+        {
+            SearchLimits limits;
+            limits.infinite = true;
+            int64_t ts = now_us();
+            thread.go(Board(BENCH_FENS[i % BENCH_FENS.size()]), limits);
+            go_latency.push_back((now_us() - ts) / 1000.0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10 + 7 * i % 90));
+            int64_t stop_us = thread.search().time.elapsed_us();
+            thread.stop();
+            thread.wait();
+            stop_latency.push_back((bestmove_us - stop_us) / 1000.0);
+        }
+        _print_distribution("infinite, stop", stop_latency);
+
+        std::vector<double> ponder_latency;
+        for (int i = 0; i < runs; ++i)
+        {
+            SearchLimits limits;
+            limits.ponder = true;
+            limits.movetime = 30;
+            thread.go(Board(BENCH_FENS[i % BENCH_FENS.size()]), limits);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            thread.ponderhit();
+            thread.wait();
+            ponder_latency.push_back(bestmove_us / 1000.0 - 30);
+        }
+        _print_distribution("ponderhit, movetime 30", ponder_latency);
+
+        _print_distribution("go() blocking", go_latency);
+    }
@@ -0,0 +1,35 @@
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+#include "search.h"
+
+    extern const std::vector<std::string> BENCH_FENS;
+    /* A fixed set of middlegame and endgame positions used by the benchmarks. */
+
+    void bench_see();
+
+    void bench_search(int = 5, const SearchOptions & = SearchOptions());
+
+    void bench_time(int = 20);
+
+    void bench_eval(int = 20);
+
+    void bench_nnue(int = 20, const std::string & = "");
+
+    void bench_pack(int = 20);
+
+    void bench_features(int = 20);
+
+    void bench_book(const std::string &, const std::string & = "", int = 20);
+
+    void bench_book_build(const std::string &, size_t = 0, int = 20);
+
+    void bench_explorer(const std::string &, int = 20);
+
+    void bench_selfplay(int = 20, size_t = 0, uint64_t = 2000);
+
+    void bench_fen_batch(int = 1000000, size_t = 0);
+
+    void bench_games(const std::string &, bool = false);
+
+    void bench_pgn(const std::string &, size_t = 0, bool = true);
+#endif // BENCH_H_INCLUDED
@@ -0,0 +1,34 @@
+#ifndef BINARY_H_INCLUDED
+#define BINARY_H_INCLUDED
+#include <cstdint>
+#include <string>
+
+    inline void put_le(uint8_t *data, uint64_t value, int bytes)
+    {
+        /* Writes the low *bytes* bytes of *value* to *data*, little-endian whatever the host. */
+        for (int i = 0; i < bytes; ++i)
+        {
+            data[i] = uint8_t(value >> (8 * i));
+        }
+    }
+
+    inline void put_le(std::string &buffer, uint64_t value, int bytes)
+    {
+        /* Appends the low *bytes* bytes of *value* to *buffer*, little-endian. */
+        for (int i = 0; i < bytes; ++i)
+        {
+            buffer.push_back(char(value >> (8 * i)));
+        }
+    }
+
+    inline uint64_t get_le(const uint8_t *data, int bytes)
+    {
+        /* Reads a little-endian number of *bytes* bytes at *data*. */
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= uint64_t(data[i]) << (8 * i);
+        }
+        return value;
+    }
+#endif // BINARY_H_INCLUDED
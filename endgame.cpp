@@ -0,0 +1,269 @@
+#include "endgame.h"
+#include "zobrist.h"
+#include <bitset>
+#include <unordered_map>
+
+    Bitboard material_key(const std::string &code, Color strong)
+    {
+        /*
+        Gets the :data:`~BaseBoard::material_key` of a material signature
+        like ``KBNK``: the pieces of the strong side, starting with its
+        king, followed by the pieces of the weak side.
+        */
+        int counts[2][7] = {};
+        Color color = strong;
+        for (size_t i = 0; i < code.size(); ++i)
+        {
+            if (i && code[i] == 'K')
+            {
+                color = !strong;
+            }
+            PieceType piece_type = std::string(" PNBRQK").find(code[i]);
+            ++counts[color][piece_type];
+        }
+
+        Bitboard key = 0;
+        for (Color c : {WHITE, BLACK})
+        {
+            for (PieceType piece_type = PAWN; piece_type <= KING; ++piece_type)
+            {
+                for (int i = 0; i < counts[c][piece_type]; ++i)
+                {
+                    key ^= ZOBRIST.pieces[c][piece_type][i];
+                }
+            }
+        }
+        return key;
+    }
+
+    EndgameFunction find_endgame(Bitboard key, Color &strong)
+    {
+        /*
+        Gets the specialized evaluator of the material with *key* and sets
+        *strong* to the side it assumes to be winning, or returns
+        ``nullptr`` if there is none.
+        */
+        static const std::unordered_map<Bitboard, std::pair<EndgameFunction, Color>> endgames = []
+        {
+            std::unordered_map<Bitboard, std::pair<EndgameFunction, Color>> map;
+            const std::pair<const char *, EndgameFunction> signatures[] =
+            {
+                {"KRK", evaluate_kxk},
+                {"KQK", evaluate_kxk},
+                {"KBNK", evaluate_kbnk},
+                {"KQKR", evaluate_kqkr},
+                {"KPK", evaluate_kpk},
+            };
+            for (const auto &[code, function] : signatures)
+            {
+                for (Color color : {WHITE, BLACK})
+                {
+                    map[material_key(code, color)] = {function, color};
+                }
+            }
+            return map;
+        }();
+
+        auto it = endgames.find(key);
+        if (it == endgames.end())
+        {
+            return nullptr;
+        }
+        strong = it->second.second;
+        return it->second.first;
+    }
+
+    const int KPK_INVALID = 0, KPK_UNKNOWN = 1, KPK_DRAW = 2, KPK_WIN = 4;
+
+    const unsigned KPK_SIZE = 2 * 24 * 64 * 64;
+
+    static unsigned _kpk_index(bool weak_to_move, Square weak_king, Square strong_king, Square pawn)
+    {
+        return strong_king | weak_king << 6 | weak_to_move << 12 | square_file(pawn) << 13 | (6 - square_rank(pawn)) << 15;
+    }
+
+    class _KPKPosition
+    {
+        /*
+        A king and pawn versus king position with the pawn of white on the
+        files a to d, as it is classified by the retrograde analysis of
+        :func:`kpk_probe()`.
+        */
+
+    public:
+        bool weak_to_move;
+
+        Square kings[2];
+
+        Square pawn;
+
+        int result;
+
+        _KPKPosition(unsigned index)
+        {
+            this->kings[WHITE] = index & 0x3F;
+            this->kings[BLACK] = (index >> 6) & 0x3F;
+            this->weak_to_move = (index >> 12) & 1;
+            this->pawn = square((index >> 13) & 3, 6 - ((index >> 15) & 7));
+            Square stop = this->pawn + 8;
+
+            // Two pieces on one square or a king that can be captured.
+            if (square_distance(this->kings[WHITE], this->kings[BLACK]) <= 1 ||
+                this->kings[WHITE] == this->pawn || this->kings[BLACK] == this->pawn ||
+                (!this->weak_to_move && (BB_PAWN_ATTACKS[WHITE][this->pawn] & BB_SQUARES[this->kings[BLACK]])))
+            {
+                this->result = KPK_INVALID;
+            }
+            // The pawn promotes and cannot be captured.
+            else if (!this->weak_to_move && square_rank(this->pawn) == 6 && this->kings[WHITE] != stop &&
+                     (square_distance(this->kings[BLACK], stop) > 1 || (BB_KING_ATTACKS[this->kings[WHITE]] & BB_SQUARES[stop])))
+            {
+                this->result = KPK_WIN;
+            }
+            // Stalemate, or the king captures an undefended pawn.
+            else if (this->weak_to_move &&
+                     (!(BB_KING_ATTACKS[this->kings[BLACK]] & ~(BB_KING_ATTACKS[this->kings[WHITE]] | BB_PAWN_ATTACKS[WHITE][this->pawn])) ||
+                      (BB_KING_ATTACKS[this->kings[BLACK]] & BB_SQUARES[this->pawn] & ~BB_KING_ATTACKS[this->kings[WHITE]])))
+            {
+                this->result = KPK_DRAW;
+            }
+            else
+            {
+                this->result = KPK_UNKNOWN;
+            }
+        }
+
+        int classify(const std::vector<_KPKPosition> &positions)
+        {
+            /*
+            White wins if one of its moves wins, black draws if one of its
+            moves draws. Otherwise the result stays unknown while one of the
+            successors is unknown.
+            */
+            bool strong_to_move = !this->weak_to_move;
+            int good = strong_to_move ? KPK_WIN : KPK_DRAW;
+            int bad = strong_to_move ? KPK_DRAW : KPK_WIN;
+            int r = KPK_INVALID;
+            for (Bitboard bb = BB_KING_ATTACKS[this->kings[strong_to_move]]; bb; bb &= bb - 1)
+            {
+                r |= strong_to_move ? positions[_kpk_index(true, this->kings[BLACK], lsb(bb), this->pawn)].result
+                                    : positions[_kpk_index(false, lsb(bb), this->kings[WHITE], this->pawn)].result;
+            }
+            if (strong_to_move && square_rank(this->pawn) < 6)
+            {
+                Square stop = this->pawn + 8;
+                r |= positions[_kpk_index(true, this->kings[BLACK], this->kings[WHITE], stop)].result;
+                if (square_rank(this->pawn) == 1 && stop != this->kings[WHITE] && stop != this->kings[BLACK])
+                {
+                    r |= positions[_kpk_index(true, this->kings[BLACK], this->kings[WHITE], stop + 8)].result;
+                }
+            }
+            return this->result = r & good ? good : r & KPK_UNKNOWN ? KPK_UNKNOWN : bad;
+        }
+    };
+
+    bool kpk_probe(Square strong_king, Square pawn, Square weak_king, bool weak_to_move)
+    {
+        /*
+        Checks if white wins a king and pawn versus king position with the
+        pawn on the files a to d. The bitbase is generated by retrograde
+        analysis on first use.
+        */
+        static const std::bitset<KPK_SIZE> bitbase = []
+        {
+            std::vector<_KPKPosition> positions;
+            positions.reserve(KPK_SIZE);
+            for (unsigned index = 0; index < KPK_SIZE; ++index)
+            {
+                positions.emplace_back(index);
+            }
+            for (bool repeat = true; repeat;)
+            {
+                repeat = false;
+                for (unsigned index = 0; index < KPK_SIZE; ++index)
+                {
+                    repeat |= positions[index].result == KPK_UNKNOWN && positions[index].classify(positions) != KPK_UNKNOWN;
+                }
+            }
+            std::bitset<KPK_SIZE> bits;
+            for (unsigned index = 0; index < KPK_SIZE; ++index)
+            {
+                bits[index] = positions[index].result == KPK_WIN;
+            }
+            return bits;
+        }();
+        return bitbase[_kpk_index(weak_to_move, weak_king, strong_king, pawn)];
+    }
+
+    Value evaluate_kxk(const Board &board, Color strong)
+    {
+        /*
+        A rook or a queen against the lone king: a known win. Drives the
+        weak king to the edge and the strong king towards it.
+        */
+        Square strong_king = lsb(board.pieces_mask(KING, strong));
+        Square weak_king = lsb(board.pieces_mask(KING, !strong));
+        if (board.turn != strong && board.is_stalemate())
+        {
+            return VALUE_DRAW;
+        }
+        return VALUE_KNOWN_WIN + PIECE_VALUES[board.pieces_mask(QUEEN, strong) ? QUEEN : ROOK] +
+               PushToEdges[weak_king] + PushClose[square_distance(strong_king, weak_king)];
+    }
+
+    Value evaluate_kbnk(const Board &board, Color strong)
+    {
+        /*
+        Bishop and knight against the lone king: a known win, but only in
+        the corners of the color of the bishop, so the weak king is driven
+        there.
+        */
+        Square strong_king = lsb(board.pieces_mask(KING, strong));
+        Square weak_king = lsb(board.pieces_mask(KING, !strong));
+        if (board.turn != strong && board.is_stalemate())
+        {
+            return VALUE_DRAW;
+        }
+        // PushToCorners favors a1 and h8. With a light squared bishop the
+        // board is flipped to drive the king to a8 or h1 instead.
+        if (board.pieces_mask(BISHOP, strong) & BB_LIGHT_SQUARES)
+        {
+            weak_king ^= 7;
+        }
+        return VALUE_KNOWN_WIN + PushClose[square_distance(strong_king, weak_king)] + PushToCorners[weak_king];
+    }
+
+    Value evaluate_kqkr(const Board &board, Color strong)
+    {
+        /*
+        Queen against rook: usually won, but it takes long. Drives the weak
+        king to the edge and the strong king towards it.
+        */
+        Square strong_king = lsb(board.pieces_mask(KING, strong));
+        Square weak_king = lsb(board.pieces_mask(KING, !strong));
+        return PIECE_VALUES[QUEEN] - PIECE_VALUES[ROOK] + PushToEdges[weak_king] + PushClose[square_distance(strong_king, weak_king)];
+    }
+
+    Value evaluate_kpk(const Board &board, Color strong)
+    {
+        /*
+        King and pawn against king: exact with the bitbase of
+        :func:`kpk_probe()`. Won positions are preferred by how far the pawn
+        has advanced.
+        */
+        Square strong_king = lsb(board.pieces_mask(KING, strong));
+        Square weak_king = lsb(board.pieces_mask(KING, !strong));
+        Square pawn = lsb(board.pieces_mask(PAWN, strong));
+
+        // Normalize to a white pawn on the files a to d.
+        int flip = (square_file(pawn) >= 4 ? 7 : 0) ^ (strong == WHITE ? 0 : 0x38);
+        strong_king ^= flip;
+        weak_king ^= flip;
+        pawn ^= flip;
+
+        if (!kpk_probe(strong_king, pawn, weak_king, board.turn != strong))
+        {
+            return VALUE_DRAW;
+        }
+        return VALUE_KNOWN_WIN + PIECE_VALUES[PAWN] + square_rank(pawn);
+    }
@@ -0,0 +1,51 @@
+#ifndef ENDGAME_H_INCLUDED
+#define ENDGAME_H_INCLUDED
+#include "eval.h"
+
+    using EndgameFunction = Value (*)(const Board &, Color);
+    /*
+    A specialized evaluator for one material signature. Gets the board and
+    the strong side and returns a value from the point of view of the
+    strong side.
+    */
+
+    constexpr int PushToEdges[64] =
+    {
+        100, 90, 80, 70, 70, 80, 90, 100,
+         90, 70, 60, 50, 50, 60, 70,  90,
+         80, 60, 40, 30, 30, 40, 60,  80,
+         70, 50, 30, 20, 20, 30, 50,  70,
+         70, 50, 30, 20, 20, 30, 50,  70,
+         80, 60, 40, 30, 30, 40, 60,  80,
+         90, 70, 60, 50, 50, 60, 70,  90,
+        100, 90, 80, 70, 70, 80, 90, 100
+    };
+
+    constexpr int PushToCorners[64] =
+    {
+        6400, 6080, 5760, 5440, 5120, 4800, 4480, 4160,
+        6080, 5760, 5440, 5120, 4800, 4480, 4160, 4480,
+        5760, 5440, 4960, 4480, 4480, 4000, 4480, 4800,
+        5440, 5120, 4480, 3840, 3520, 4480, 4800, 5120,
+        5120, 4800, 4480, 3520, 3840, 4480, 5120, 5440,
+        4800, 4480, 4000, 4480, 4480, 4960, 5440, 5760,
+        4480, 4160, 4480, 4800, 5120, 5440, 5760, 6080,
+        4160, 4480, 4800, 5120, 5440, 5760, 6080, 6400
+    };
+
+    constexpr int PushClose[8] = {0, 0, 100, 80, 60, 40, 20, 10};
+
+    Bitboard material_key(const std::string &, Color);
+
+    EndgameFunction find_endgame(Bitboard, Color &);
+
+    bool kpk_probe(Square, Square, Square, bool);
+
+    Value evaluate_kxk(const Board &, Color);
+
+    Value evaluate_kbnk(const Board &, Color);
+
+    Value evaluate_kqkr(const Board &, Color);
+
+    Value evaluate_kpk(const Board &, Color);
+#endif // ENDGAME_H_INCLUDED
@@ -1,13 +1,15 @@
-#include "eval.h"
-Score Fianchetto(Board board, Color pov)
+#include "pawns.h"
+#include "material.h"
+#include <cassert>
+Score Fianchetto(const Board &board, Color pov)
 {
-    return popcount(board.pieces_mask(BISHOP, pov) & (0x4200 << 40*(!pov)));
+    return popcount(board.pieces_mask(BISHOP, pov) & (0x4200ULL << 40*(!pov)));
 }
-Score BishopPair(Board board, Color color)
+Score BishopPair(const Board &board, Color color)
 {
     return !board.pieces_mask(BISHOP, color) %2 * 12;
 }
-bool is_bad_bishop(Board board, Square square)
+bool is_bad_bishop(const Board &board, Square square)
 {
     optional<Piece> piece = board.piece_at(square);
     if (piece && piece.value().piece_type == BISHOP)
@@ -15,10 +17,10 @@ bool is_bad_bishop(Board board, Square square)
         // Get the color of the bishop
         Color color = piece.value().color;
         // Get the central pawns (squares in front of the bishop)
-        std::vector<Square> central_pawns = {square + SQUARES[55],square + SQUARES[47]};
+        const Square central_pawns[] = {square + SQUARES[55],square + SQUARES[47]};
         for (Square pawn_square : central_pawns)
         {
-            if (board.piece_at(pawn_square) && board.piece_at(pawn_square).value().color == color)
+            if (pawn_square < 64 && board.piece_at(pawn_square) && board.piece_at(pawn_square).value().color == color)
             {
                 return true;
             }
@@ -26,195 +28,108 @@ bool is_bad_bishop(Board board, Square square)
     }
     return false;
 }
-Board colorflip(Board board)
+Score piece_value_bonus(const Board &pos, Square square, bool mg)
 {
-    return board.mirror();
-}
-Score space_area(Board pos, Square sq)
-{
-    int v = 0;
-    int rank = square_rank(sq);
-    int file = square_file(sq);
-
-    if ((rank >= 2 && rank <= 4 && file >= 3 && file <= 6)
-            && (pos.piece_at(sq).value_or(Piece(PAWN, BLACK)).symbol() != 'P')
-            && (pos.piece_at(square(file-1, rank-1)).value_or(Piece(PAWN, WHITE)).symbol() != 'p')
-            && (pos.piece_at(square(file + 1, rank - 1)).value_or(Piece(PAWN, WHITE)).symbol() != 'p'))
-    {
-        v++;
-
-        if ((pos.piece_at(square(file, rank - 1)).value_or(Piece(PAWN, BLACK)).symbol() == 'P' ||
-                pos.piece_at(square(file, rank - 2)).value_or(Piece(PAWN, BLACK)).symbol() == 'P'     ||
-                pos.piece_at(square(file, rank - 3)).value_or(Piece(PAWN, BLACK)).symbol() == 'P')
-                && !popcount(colorflip(pos).attacks_mask(square(file, 7-rank))))
-        {
-            v++;
-        }
-    }
-
-    return v;
-}
-Score piece_value_bonus(Board pos, Square square, bool mg)
-{
-    int a[2][5]=  {{124, 781, 825, 1276, 2538},{206, 854, 915, 1380, 2682}};
+    static const int a[2][5]=  {{124, 781, 825, 1276, 2538},{206, 854, 915, 1380, 2682}};
     int i = pos.piece_type_at(square).value_or(-1)-1;
-    if (i >= 0) return a[mg][i];
+    if (i >= 0 && i < 5) return a[mg][i];
     return 0;
 }
-Score non_pawn_material(Board pos)
+Score non_pawn_material(const Board &board, Color color)
 {
-    int total=0;
-    for (Square square:SQUARES)
-    {
-        int i = pos.piece_type_at(square).value_or(0)-1+pos.color_at(square).value_or(-1)-1;
-        if (i >= 0&& i < 5) total += piece_value_bonus(pos, square, true);
-    }
-
-    return 0;
+    return board.non_pawn_material[color];
 }
-Score space(Board board)
+Score space(const Board &board, Color us)
 {
-    if (non_pawn_material(board) + non_pawn_material(colorflip(board)) < 12222) return 0;
-    int pieceCount =popcount(board.occupied_co[WHITE]), blockedCount=0;
-    for (int x = 0; x < 8; x++)
-    {
-        for (int y=0; y < 8; y++)
-        {
-            if (board.piece_at(square(x,y)).value_or(Piece(PAWN, BLACK)).symbol()=='P' &&
-                    board.piece_at(square(x,y-1)).value_or(Piece(PAWN, WHITE)).symbol()=='p'||
-                    board.piece_at(square(x-1,y-2)).value_or(Piece(PAWN, WHITE)).symbol()=='p'&&
-                    board.piece_at(square(x,y-1)).value_or(Piece(PAWN, WHITE)).symbol()=='p')blockedCount++;
-            if (board.piece_at(square(x,y)).value_or(Piece(PAWN, WHITE)).symbol()=='p' &&
-                    board.piece_at(square(x,y-1)).value_or(Piece(PAWN, WHITE)).symbol()=='P'||
-                    board.piece_at(square(x-1,y-2)).value_or(Piece(PAWN, WHITE)).symbol()=='P'&&
-                    board.piece_at(square(x,y-1)).value_or(Piece(PAWN, WHITE)).symbol()=='P')blockedCount++;
-        }
-    }
-    int weight = pieceCount - 3 + min(blockedCount, 9);
-    int total=0;
-    for (Square sq:SQUARES)
-    {
-        total += space_area(board, sq);
-    }
+    if (non_pawn_material(board, WHITE) + non_pawn_material(board, BLACK) < 12222) return 0;
+    Color them = !us;
+    Bitboard ours = board.pieces_mask(PAWN, us), theirs = board.pieces_mask(PAWN, them);
+
+    // Blocked pawns, counted per square: a pawn directly in front of an
+    // opposing one, or a square behind two pawns of the same color on
+    // consecutive ranks of adjacent files.
+    Bitboard blocked_ours = (ours & shift_forward(theirs, us)) |
+                            (shift_forward(shift_forward(shift_east(theirs), us), us) & shift_forward(theirs, us));
+    Bitboard blocked_theirs = (theirs & shift_forward(ours, us)) |
+                              (shift_forward(shift_forward(shift_east(ours), us), us) & shift_forward(ours, us));
+    int blocked = popcount(blocked_ours) + popcount(blocked_theirs);
+    int weight = popcount(board.occupied_co[us]) - 3 + min(blocked, 9);
+
+    // Safe squares: files d to g on relative ranks 3 to 5, without our pawn
+    // and without an opposing pawn diagonally behind. Empty safe squares up
+    // to three squares in front of one of our pawns count twice.
+    Bitboard area = (BB_FILE_D | BB_FILE_E | BB_FILE_F | BB_FILE_G) &
+                    (relative_rank_bb(us, 2) | relative_rank_bb(us, 3) | relative_rank_bb(us, 4));
+    Bitboard safe = area & ~ours & ~pawn_attacks_bb(theirs, us);
+    Bitboard behind1 = shift_forward(ours, us), behind2 = shift_forward(behind1, us);
+    Bitboard behind = behind1 | behind2 | shift_forward(behind2, us);
+    int total = popcount(safe) + popcount(safe & behind & ~board.occupied);
     return (total * weight * weight / 16);
 }
-int phase(Board pos)
+int phase(const Board &pos)
 {
-    int npm = non_pawn_material(pos) + non_pawn_material(colorflip(pos));
+    int npm = non_pawn_material(pos, WHITE) + non_pawn_material(pos, BLACK);
     npm = max(EndgameLimit, min(npm, MidgameLimit));
     return (((npm - EndgameLimit) * 128) / (MidgameLimit - EndgameLimit));
 }
-std::vector<Square> get_pawn_positions(const Board& board, Color color)
+EvalInfo::EvalInfo(const Board &board)
 {
-    std::vector<Square> pawns;
-    for (Square square:scan_reversed(board.pieces_mask(PAWN,color)))
+    for (Color us : {WHITE, BLACK})
     {
-        pawns.push_back(square);
-    }
-    return pawns;
-}
-
-bool is_isolated_pawn(const Board& board, Square sq, Color color)
-{
-    int file = square_file(sq);
-    std::vector<int> files_to_check = { file - 1, file + 1 };
-    for (int f : files_to_check)
-    {
-        if (f >= 0 && f < 8)
+        for (PieceType piece_type = PAWN; piece_type <= KING; ++piece_type)
         {
-            for (int rank = 0; rank < 8; ++rank)
+            for (Bitboard bb = board.pieces_mask(piece_type, us); bb; bb &= bb - 1)
             {
-                if (board.piece_at(square(f, rank)) && board.piece_at(square(f, rank)).value() == Piece(PAWN, color))
-                {
-                    return false;
-                }
+                Square square = lsb(bb);
+                Bitboard attacks = piece_type == PAWN ? BB_PAWN_ATTACKS[us][square] : board.attacks_mask(square);
+                this->attacks[square] = attacks;
+                this->attacked_by[us][0] |= attacks;
+                this->attacked_by[us][piece_type] |= attacks;
             }
         }
     }
-    return true;
-}
 
-bool is_doubled_pawn(const Board& board, int file, Color color)
-{
-    int count = 0;
-    for (int rank = 0; rank < 8; ++rank)
+    for (Color us : {WHITE, BLACK})
     {
-        if (board.piece_at(square(file, rank)) && board.piece_at(square(file, rank)).value() == Piece(PAWN, color))
-        {
-            count++;
-        }
-    }
-    return count > 1;
-}
-
-int evaluate_pawn_structure(const Board& board)
-{
-    int score = 0;
-    std::vector<Square> white_pawns = get_pawn_positions(board, WHITE);
-    std::vector<Square> black_pawns = get_pawn_positions(board, BLACK);
+        Color them = !us;
+        Bitboard pawns = board.pieces_mask(PAWN, us);
 
-    // Evaluate white pawns
-    for (Square pawn : white_pawns)
-    {
-        int file = square_file(pawn);
-        if (square_rank(pawn) > 4 && !(board.pieces_mask(PAWN, BLACK) & BB_FILES[file])) score += PawnWt[0]+PassedRank[square_rank(pawn)]+PSQT[0][PAWN][pawn];
-        if (is_isolated_pawn(board, pawn, WHITE))
-        {
-            score -= PawnWt[2]; // Penalize isolated pawns
-        }
-        if (is_doubled_pawn(board, file, WHITE))
+        // A piece is trapped if it is attacked and all of its moves go to
+        // attacked squares. Pins and the lines the move opens are ignored.
+        Bitboard capturable = board.occupied_co[them];
+        if (board.turn == us && board.ep_square && !(board.occupied & BB_SQUARES[*board.ep_square])) capturable |= BB_SQUARES[*board.ep_square];
+        for (Bitboard bb = board.occupied_co[us] & this->attacked_by[them][0]; bb; bb &= bb - 1)
         {
-            score -= PawnWt[1]; // Penalize doubled pawns
-        }
-    }
-
-    // Evaluate black pawns
-    for (Square pawn : black_pawns)
-    {
-        int file = square_file(pawn);
-        if (square_rank(pawn) > 4 && !(board.pieces_mask(PAWN, BLACK) & BB_FILES[file])) score -= PawnWt[0]+PassedRank[square_rank(pawn)]+PSQT[0][PAWN][pawn];
-        if (is_isolated_pawn(board, pawn, BLACK))
-        {
-            score += PawnWt[2]; // Penalize isolated pawns
-        }
-        if (is_doubled_pawn(board, file, BLACK))
-        {
-            score += PawnWt[1]; // Penalize doubled pawns
-        }
-    }
+            Square square = lsb(bb);
+            Bitboard targets;
+            if (pawns & BB_SQUARES[square])
+            {
+                Bitboard single = shift_forward(BB_SQUARES[square], us) & ~board.occupied;
+                Bitboard twice = shift_forward(single & relative_rank_bb(us, 2), us) & ~board.occupied;
+                targets = single | twice | (this->attacks[square] & capturable);
+            }
+            else targets = this->attacks[square] & ~board.occupied_co[us];
 
-    return score;
-}
-bool is_trapped(Board &board,Square square, Color opponent)
-{
-    if ((board.occupied&(square))&&board.is_attacked_by(opponent, square))
-    {
-        Board board2=board.copy();
-        for (Move x:board.generate_legal_moves(1 << square, BB_ALL))
-        {
-            board2.push(x);
-            if (!board2.is_attacked_by(opponent, x.to_square)) return false;
-            board2.pop();
+            if (!(targets & ~this->attacked_by[them][0])) this->trapped[us] |= BB_SQUARES[square];
         }
-        return true;
     }
-    return false;
 }
-inline bool is_on_semiopen_file(Board &pos,Color c, Square s)
+inline bool is_on_semiopen_file(const Board &pos,Color c, Square s)
 {
     return !(pos.pieces_mask(PAWN,c) & BB_FILES[s]);
 }
-inline Score long_diagonal_bishop(Board &board)
+inline Score long_diagonal_bishop(const Board &board)
 {
     return popcount(board.pieces_mask(BISHOP,board.turn)&(1 << 9|1 << 13))*LongDiagonalBishop-popcount(board.pieces_mask(BISHOP,!board.turn)&(1 << 9|1 << 13))*LongDiagonalBishop;
 }
-bool weak_queen_protection(Board &board, Color q)
+bool weak_queen_protection(const Board &board, Color q)
 {
 
     Bitboard queens = board.pieces_mask(QUEEN, q);
 
-    for (Square queen_square:scan_reversed(queens))
+    for (; queens; queens &= queens - 1)
     {
+        Square queen_square = lsb(queens);
         Bitboard attackers = board.attackers_mask(!q, queen_square);
         Bitboard defenders = board.attackers_mask(q, queen_square);
 
@@ -223,66 +138,136 @@ bool weak_queen_protection(Board &board, Color q)
     }
     return false;
 }
-int eval(Board board)
+std::atomic<size_t> EvalCache::configured_size{4};
+
+EvalCache::EvalCache(size_t size)
+{
+    this->resize(size);
+}
+
+const EvalCacheEntry *EvalCache::probe(Bitboard key)
 {
-    //endgame:
-    //board.pieces_mask(PAWN, WHITE) & BB_RANK_5
-    //board.pieces_mask(PAWN, BLACK) & BB_RANK_4
-    Score P = 100,
-          N = 320,
-          B = 330,
-          R = 500,
-          Q = 900,
-          K = VALUE_INFINITE;
-    vector<int> count=
+    /* Returns the entry of the position with *key*, or ``nullptr``. */
+    if (this->_entries.empty())
     {
-        popcount(board.pieces_mask(PAWN, WHITE))-popcount(board.pieces_mask(PAWN, BLACK)),
-        popcount(board.pieces_mask(KNIGHT, WHITE))-popcount(board.pieces_mask(KNIGHT, BLACK)),
-        popcount(board.pieces_mask(BISHOP, WHITE))-popcount(board.pieces_mask(BISHOP, BLACK)),
-        popcount(board.pieces_mask(ROOK, WHITE))-popcount(board.pieces_mask(ROOK, BLACK)),
-        popcount(board.pieces_mask(QUEEN, WHITE))-popcount(board.pieces_mask(QUEEN, BLACK)),
-        popcount(board.pieces_mask(KING, WHITE))-popcount(board.pieces_mask(KING, BLACK))
-    };
-    int evalu=count[0]*P+count[1]*N+count[2]*B+count[3]*R+count[4]*Q+count[5]*K;
-    // Control
-    // Control is closely associated with "Space"
-    // We will calculate for every square the delta of white attackers to black attackers and sum the deltas
-    int control, whitecontrol = 0, blackcontrol= 0;
-    for (Square spacesquare: SQUARES)
+        return nullptr;
+    }
+    const EvalCacheEntry &entry = this->_entries[key & (this->_entries.size() - 1)];
+    if (entry.key == key)
     {
-        whitecontrol += popcount(board.attackers_mask(WHITE, spacesquare));
-        blackcontrol += popcount(board.attackers_mask(BLACK, spacesquare));
+        ++this->hits;
+        return &entry;
     }
-    control = whitecontrol - blackcontrol;
-    for (Square c:scan_reversed(board.occupied_co[board.turn]))
+    ++this->misses;
+    return nullptr;
+}
+
+void EvalCache::store(Bitboard key, Value value, Score score)
+{
+    /* Stores an evaluation, replacing whatever was in its slot. */
+    if (!this->_entries.empty())
     {
-        optional<Piece> piece = board.piece_at(c);
-        if (piece)
-            evalu += pesto_table[phase(board)==0][piece.value().piece_type][c]/10;
+        this->_entries[key & (this->_entries.size() - 1)] = {key, value, score};
     }
-    for (Square c:scan_reversed(board.occupied_co[board.turn]))
+}
+
+void EvalCache::resize(size_t size)
+{
+    /* Resizes the cache to *size* MiB, rounded down to a power of two entries, and clears it. */
+    this->_size = size;
+    this->_entries.clear();
+    this->_entries.shrink_to_fit();
+    if (size)
     {
-        optional<Piece>piece = board.piece_at(c);
-        if (piece)
-            evalu += PSQT[phase(board)==0][piece.value().piece_type][c]/10;
+        this->_entries.resize(std::bit_floor(size * 1024 * 1024 / sizeof(EvalCacheEntry)));
     }
-    for (Square c:scan_reversed(board.occupied_co[!board.turn]))
+    this->hits = this->misses = 0;
+}
+
+size_t EvalCache::size() const
+{
+    return this->_size;
+}
+
+void EvalCache::clear()
+{
+    /* Forgets all entries and resets the counters. */
+    std::fill(this->_entries.begin(), this->_entries.end(), EvalCacheEntry());
+    this->hits = this->misses = 0;
+}
+
+double EvalCache::hit_rate() const
+{
+    uint64_t probes = this->hits + this->misses;
+    return probes ? double(this->hits) / probes : 0;
+}
+
+EvalCache &thread_eval_cache()
+{
+    /* The evaluation cache of the calling thread, resized to :data:`EvalCache::configured_size`. */
+    thread_local EvalCache cache;
+    size_t size = EvalCache::configured_size.load(std::memory_order_relaxed);
+    if (cache.size() != size)
     {
-        optional<Piece> piece = board.piece_at(c);
-        if (piece)
-            evalu -= pesto_table[phase(board)==0][piece.value().piece_type][c]/10;
+        cache.resize(size);
     }
-    for (Square c:scan_reversed(board.occupied_co[!board.turn]))
+    return cache;
+}
+
+Value eval(const Board &board)
+{
+    /*
+    Evaluates *board* from the point of view of white. Reads the board only:
+    no copies, no moves pushed and no heap allocations. Material and piece
+    square bonuses come from the incrementally updated :data:`~BaseBoard::psq`;
+    builds without ``NDEBUG`` check it against a recount first.
+
+    All terms are accumulated as packed midgame/endgame scores and blended
+    once at the end according to the game phase. Known endgames and
+    insufficient material are recognized with one probe of the
+    :class:`MaterialTable`. Results are kept in the :class:`EvalCache` of
+    the calling thread.
+    */
+    EvalCache &cache = thread_eval_cache();
+    Bitboard key = board.zobrist_key();
+    if (const EvalCacheEntry *entry = cache.probe(key))
     {
-        optional<Piece> piece = board.piece_at(c);
-        if (piece)
-            evalu -= PSQT[phase(board)==0][piece.value().piece_type][c]/10;
+        return entry->value;
     }
-    evalu += evaluate_pawn_structure(board);
-    evalu += space(board) - space(board.mirror());
-    for (Square x:scan_reversed(board.occupied_co[board.turn]))
-        evalu += is_trapped(board, x,!board.turn)*TrappedRook;
-    for (Square x:scan_reversed(board.occupied_co[!board.turn]))
-        evalu -= is_trapped(board, x,board.turn)*TrappedRook;
-    return evalu;
+
+    assert(board.check_incremental());
+    const MaterialEntry &material = thread_material_table().probe(board);
+    if (material.endgame || material.is_insufficient_material(board))
+    {
+        Value value = VALUE_DRAW;
+        if (material.endgame)
+        {
+            value = material.endgame(board, material.strong_side);
+            value = material.strong_side == WHITE ? value : -value;
+        }
+        cache.store(key, value, make_score(value, value));
+        return value;
+    }
+
+    Score score = board.psq + material.imbalance;
+
+    const PawnStructure &pawns = thread_pawn_table().probe(board);
+    score += pawns.score;
+    score += make_score(space(board, WHITE) - space(board, BLACK), 0);
+
+    EvalInfo info(board);
+    score -= TrappedRook * (popcount(info.trapped[WHITE]) - popcount(info.trapped[BLACK]));
+
+    // Opposite colored bishops are drawish in the endgame, less so with
+    // passed pawns.
+    int eg = eg_value(score);
+    if (material.opposite_bishops && (board.bishops & BB_DARK_SQUARES) && (board.bishops & BB_LIGHT_SQUARES))
+    {
+        eg = eg * min(16 + 4 * popcount(pawns.passed[WHITE] | pawns.passed[BLACK]), 64) / 64;
+    }
+
+    int ph = phase(board);
+    Value value = (mg_value(score) * ph + eg * (128 - ph)) / 128;
+    cache.store(key, value, score);
+    return value;
 }
@@ -1,8 +1,8 @@
 #ifndef EVAL_H_INCLUDED
 #define EVAL_H_INCLUDED
 #include "Board.h"
+#include <atomic>
 using namespace std;
-using Score=int;
 const int MAX_PLY=246;
 using Value=int;
 static int
@@ -27,289 +27,107 @@ Tempo = 28,
 
 MidgameLimit  = 15258, EndgameLimit  = 3915;
 
-constexpr Score make_score(int mg, int eg)
+inline Value mg_value(Score s)
 {
-    return Score((int)((unsigned int)eg << 16) + mg);
+    return Value(int16_t(uint16_t(unsigned(s))));
 }
-#define S(mg, eg) make_score(mg, eg)
-#define TUNEP(i,wt) PawnWt[i]=wt;
-static std::vector<Score> P=
+inline Value eg_value(Score s)
 {
-    0,  0,  0,  0,  0,  0,  0,  0,
-    50, 50, 50, 50, 50, 50, 50, 50,
-    10, 10, 20, 30, 30, 20, 10, 10,
-    5,  5, 10, 25, 25, 10,  5,  5,
-    0,  0,  0, 20, 20,  0,  0,  0,
-    5, -5,-10,  0,  0,-10, -5,  5,
-    5, 10, 10,-20,-20, 10, 10,  5,
-    0,  0,  0,  0,  0,  0,  0,  0
-};
-static std::vector<Score> N=
-{
-    -50,-40,-30,-30,-30,-30,-40,-50,
-        -40,-20,  0,  0,  0,  0,-20,-40,
-        -30,  0, 10, 15, 15, 10,  0,-30,
-        -30,  5, 15, 20, 20, 15,  5,-30,
-        -30,  0, 15, 20, 20, 15,  0,-30,
-        -30,  5, 10, 15, 15, 10,  5,-30,
-        -40,-20,  0,  5,  5,  0,-20,-40,
-        -50,-40,-30,-30,-30,-30,-40,-50,
-    };
-static std::vector<Score> B=
+    return Value(int16_t(uint16_t(unsigned(s + 0x8000) >> 16)));
+}
+/*
+int centerDistance(Square sq)
 {
-    -20,-10,-10,-10,-10,-10,-10,-20,
-        -10,  0,  0,  0,  0,  0,  0,-10,
-        -10,  0,  5, 10, 10,  5,  0,-10,
-        -10,  5,  5, 10, 10,  5,  5,-10,
-        -10,  0, 10, 10, 10, 10,  0,-10,
-        -10, 10, 10, 10, 10, 10, 10,-10,
-        -10,  5,  0,  0,  0,  0,  5,-10,
-        -20,-10,-10,-10,-10,-10,-10,-20,
-    };
-static std::vector<Score> R=
+    const Bitboard bit0 = 0xFF81BDA5A5BD81FFULL;
+    const Bitboard bit1 = 0xFFFFC3C3C3C3FFFFULL;
+    return 2 * ((bit1 >> sq) & 1) + ((bit0 >> sq) & 1);
+}*/
+static Bitboard DOUBLED_PAWNS[2]= {BB_RANK_2 | BB_RANK_3, BB_RANK_7 | BB_RANK_6};
+constexpr Score PassedRank[8] =
 {
-    0,  0,  0,  0,  0,  0,  0,  0,
-    5, 10, 10, 10, 10, 10, 10,  5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    0,  0,  0,  5,  5,  0,  0,  0
+    S(0, 0), S(10, 28), S(17, 33), S(15, 41), S(62, 72), S(168, 177), S(276, 260)
 };
-static std::vector<Score> Q=
-{
-    -20,-10,-10, -5, -5,-10,-10,-20,
-        -10,  0,  0,  0,  0,  0,  0,-10,
-        -10,  0,  5,  5,  5,  5,  0,-10,
-        -5,  0,  5,  5,  5,  5,  0, -5,
-        0,  0,  5,  5,  5,  5,  0, -5,
-        -10,  5,  5,  5,  5,  5,  0,-10,
-        -10,  0,  5,  0,  0,  0,  0,-10,
-        -20,-10,-10, -5, -5,-10,-10,-20
-    };
-static std::vector<Score> K=
-{
-    -30,-40,-40,-50,-50,-40,-40,-30,
-        -30,-40,-40,-50,-50,-40,-40,-30,
-        -30,-40,-40,-50,-50,-40,-40,-30,
-        -30,-40,-40,-50,-50,-40,-40,-30,
-        -20,-30,-30,-40,-40,-30,-30,-20,
-        -10,-20,-20,-20,-20,-20,-20,-10,
-        20, 20,  0,  0,  0,  0, 20, 20,
-        20, 30, 10,  0,  0, 10, 30, 20
-    };
-static std::vector<Score> K_end=
-{
-    -50,-40,-30,-20,-20,-30,-40,-50,
-        -30,-20,-10,  0,  0,-10,-20,-30,
-        -30,-10, 20, 30, 30, 20,-10,-30,
-        -30,-10, 30, 40, 40, 30,-10,-30,
-        -30,-10, 30, 40, 40, 30,-10,-30,
-        -30,-10, 20, 30, 30, 20,-10,-30,
-        -30,-30,  0,  0,  0,  0,-30,-30,
-        -50,-30,-30,-30,-30,-30,-30,-50
-    };
-static vector<Score> P_end=
+
+constexpr Score Hanging             = S( 69, 36);
+constexpr Score KnightOnQueen       = S( 16, 11);
+constexpr Score LongDiagonalBishop  = S( 45,  0);
+constexpr Score RestrictedPiece     = S(  7,  7);
+constexpr Score TrappedRook         = S( 55, 13);
+constexpr Score WeakQueenProtection = S( 14,  0);
+constexpr Score WeakQueen           = S( 56, 15);
+class EvalInfo
 {
-    0,0,0,0,0,0,0,0,
-    50,50,50,50,50,50,50,50,
-    40,40,40,40,40,40,40,40,
-    30,30,30,30,30,30,30,30,
-    20,20,20,20,20,20,20,20,
-    10,10,10,10,10,10,10,10,
-    10,10,10,10,10,10,10,10,
-    0,0,0,0,0,0,0,0
+    /*
+    Attack sets of both sides, computed once per :func:`eval()` call with a
+    single pass over the pieces and shared by the evaluation terms.
+    */
+
+public:
+    Bitboard attacks[64] = {};
+    /* Squares attacked by the piece on each square, empty squares are 0. */
+
+    Bitboard attacked_by[2][7] = {};
+    /* Squares attacked by the pieces of a color and type. Index 0 is all pieces. */
+
+    Bitboard trapped[2] = {0, 0};
+    /* Attacked pieces with no move to a square that is not attacked. */
+
+    EvalInfo(const Board &);
 };
-static vector<Score> PSQT[2][7]=
+class EvalCacheEntry
 {
-    {{0},P,N,B,R,Q,K},
-    {{0},P_end, N,B,R,Q,K_end}
-};
+public:
+    Bitboard key = 0;
+    /* The :func:`~Board::zobrist_key()` of the position. */
 
-static Score mg_pawn_table[64] =
-{
-    0,   0,   0,   0,   0,   0,  0,   0,
-    98, 134,  61,  95,  68, 126, 34, -11,
-    -6,   7,  26,  31,  65,  56, 25, -20,
-    -14,  13,   6,  21,  23,  12, 17, -23,
-    -27,  -2,  -5,  12,  17,   6, 10, -25,
-    -26,  -4,  -4, -10,   3,   3, 33, -12,
-    -35,  -1, -20, -23, -15,  24, 38, -22,
-    0,   0,   0,   0,   0,   0,  0,   0,
-};
+    Value value = 0;
+    /* The result of :func:`eval()`. */
 
-static Score eg_pawn_table[64] =
-{
-    0,   0,   0,   0,   0,   0,   0,   0,
-    178, 173, 158, 134, 147, 132, 165, 187,
-    94, 100,  85,  67,  56,  53,  82,  84,
-    32,  24,  13,   5,  -2,   4,  17,  17,
-    13,   9,  -3,  -7,  -7,  -8,   3,  -1,
-    4,   7,  -6,   1,   0,  -5,  -1,  -8,
-    13,   8,   8,  10,  13,   0,   2,  -7,
-    0,   0,   0,   0,   0,   0,   0,   0,
+    Score score = 0;
+    /* The packed midgame/endgame score before it was blended by phase. */
 };
-
-static Score mg_knight_table[64] =
+class EvalCache
 {
-    -167, -89, -34, -49,  61, -97, -15, -107,
-        -73, -41,  72,  36,  23,  62,   7,  -17,
-        -47,  60,  37,  65,  84, 129,  73,   44,
-        -9,  17,  19,  53,  37,  69,  18,   22,
-        -13,   4,  16,  13,  28,  19,  21,   -8,
-        -23,  -9,  12,  10,  19,  17,  25,  -16,
-        -29, -53, -12,  -3,  -1,  18, -14,  -19,
-        -105, -21, -58, -33, -17, -28, -19,  -23,
-    };
+    /*
+    A direct-mapped cache of evaluations indexed by
+    :func:`~Board::zobrist_key()`. The evaluation only depends on the
+    position, so entries never go stale and the cache needs no clearing
+    between games.
 
-static Score eg_knight_table[64] =
-{
-    -58, -38, -13, -28, -31, -27, -63, -99,
-        -25,  -8, -25,  -2,  -9, -25, -24, -52,
-        -24, -20,  10,   9,  -1,  -9, -19, -41,
-        -17,   3,  22,  22,  22,  11,   8, -18,
-        -18,  -6,  16,  25,  16,  17,   4, -18,
-        -23,  -3,  -1,  15,  10,  -3, -20, -22,
-        -42, -20, -10,  -5,  -2, -20, -23, -44,
-        -29, -51, -23, -15, -22, -18, -50, -64,
-    };
+    Not thread-safe: every thread uses its own, see
+    :func:`thread_eval_cache()`.
+    */
 
-static Score mg_bishop_table[64] =
-{
-    -29,   4, -82, -37, -25, -42,   7,  -8,
-        -26,  16, -18, -13,  30,  59,  18, -47,
-        -16,  37,  43,  40,  35,  50,  37,  -2,
-        -4,   5,  19,  50,  37,  37,   7,  -2,
-        -6,  13,  13,  26,  34,  12,  10,   4,
-        0,  15,  15,  15,  14,  27,  18,  10,
-        4,  15,  16,   0,   7,  21,  33,   1,
-        -33,  -3, -14, -21, -13, -12, -39, -21,
-    };
+public:
+    static std::atomic<size_t> configured_size;
+    /*
+    Size of the cache of every thread in MiB; 0 disables caching. Threads
+    resize their cache when they next evaluate. Set by the UCI "Hash" option.
+    */
 
-static Score eg_bishop_table[64] =
-{
-    -14, -21, -11,  -8, -7,  -9, -17, -24,
-        -8,  -4,   7, -12, -3, -13,  -4, -14,
-        2,  -8,   0,  -1, -2,   6,   0,   4,
-        -3,   9,  12,   9, 14,  10,   3,   2,
-        -6,   3,  13,  19,  7,  10,  -3,  -9,
-        -12,  -3,   8,  10, 13,   3,  -7, -15,
-        -14, -18,  -7,  -1,  4,  -9, -15, -27,
-        -23,  -9, -23,  -5, -9, -16,  -5, -17,
-    };
+    uint64_t hits = 0;
 
-static Score mg_rook_table[64] =
-{
-    32,  42,  32,  51, 63,  9,  31,  43,
-    27,  32,  58,  62, 80, 67,  26,  44,
-    -5,  19,  26,  36, 17, 45,  61,  16,
-    -24, -11,   7,  26, 24, 35,  -8, -20,
-    -36, -26, -12,  -1,  9, -7,   6, -23,
-    -45, -25, -16, -17,  3,  0,  -5, -33,
-    -44, -16, -20,  -9, -1, 11,  -6, -71,
-    -19, -13,   1,  17, 16,  7, -37, -26,
-};
+    uint64_t misses = 0;
 
-static Score eg_rook_table[64] =
-{
-    13, 10, 18, 15, 12,  12,   8,   5,
-    11, 13, 13, 11, -3,   3,   8,   3,
-    7,  7,  7,  5,  4,  -3,  -5,  -3,
-    4,  3, 13,  1,  2,   1,  -1,   2,
-    3,  5,  8,  4, -5,  -6,  -8, -11,
-    -4,  0, -5, -1, -7, -12,  -8, -16,
-    -6, -6,  0,  2, -9,  -9, -11,  -3,
-    -9,  2,  3, -1, -5, -13,   4, -20,
-};
+    EvalCache(size_t = 0);
 
-static Score mg_queen_table[64] =
-{
-    -28,   0,  29,  12,  59,  44,  43,  45,
-        -24, -39,  -5,   1, -16,  57,  28,  54,
-        -13, -17,   7,   8,  29,  56,  47,  57,
-        -27, -27, -16, -16,  -1,  17,  -2,   1,
-        -9, -26,  -9, -10,  -2,  -4,   3,  -3,
-        -14,   2, -11,  -2,  -5,   2,  14,   5,
-        -35,  -8,  11,   2,   8,  15,  -3,   1,
-        -1, -18,  -9,  10, -15, -25, -31, -50,
-    };
+    const EvalCacheEntry *probe(Bitboard);
 
-static Score eg_queen_table[64] =
-{
-    -9,  22,  22,  27,  27,  19,  10,  20,
-        -17,  20,  32,  41,  58,  25,  30,   0,
-        -20,   6,   9,  49,  47,  35,  19,   9,
-        3,  22,  24,  45,  57,  40,  57,  36,
-        -18,  28,  19,  47,  31,  34,  39,  23,
-        -16, -27,  15,   6,   9,  17,  10,   5,
-        -22, -23, -30, -16, -16, -23, -36, -32,
-        -33, -28, -22, -43,  -5, -32, -20, -41,
-    };
+    void store(Bitboard, Value, Score);
 
-static Score mg_king_table[64] =
-{
-    -65,  23,  16, -15, -56, -34,   2,  13,
-        29,  -1, -20,  -7,  -8,  -4, -38, -29,
-        -9,  24,   2, -16, -20,   6,  22, -22,
-        -17, -20, -12, -27, -30, -25, -14, -36,
-        -49,  -1, -27, -39, -46, -44, -33, -51,
-        -14, -14, -22, -46, -44, -30, -15, -27,
-        1,   7,  -8, -64, -43, -16,   9,   8,
-        -15,  36,  12, -54,   8, -28,  24,  14,
-    };
+    void resize(size_t);
 
-static Score eg_king_table[64] =
-{
-    -74, -35, -18, -18, -11,  15,   4, -17,
-        -12,  17,  14,  17,  17,  38,  23,  11,
-        10,  17,  23,  15,  20,  45,  44,  13,
-        -8,  22,  24,  27,  26,  33,  26,   3,
-        -18,  -4,  21,  24,  27,  23,   9, -11,
-        -19,  -3,  11,  21,  23,  16,   7,  -9,
-        -27, -11,   4,  13,  14,   4,  -5, -17,
-        -53, -34, -21, -11, -28, -14, -24, -43
-    };
+    size_t size() const;
 
-static Score* pesto_table[2][6] =
-{
+    void clear();
 
-    {
-        mg_pawn_table,
-        mg_knight_table,
-        mg_bishop_table,
-        mg_rook_table,
-        mg_queen_table,
-        mg_king_table
-    },
-    {
-        eg_pawn_table,
-        eg_knight_table,
-        eg_bishop_table,
-        eg_rook_table,
-        eg_queen_table,
-        eg_king_table
-    }
-};/*
-int centerDistance(Square sq)
-{
-    const Bitboard bit0 = 0xFF81BDA5A5BD81FFULL;
-    const Bitboard bit1 = 0xFFFFC3C3C3C3FFFFULL;
-    return 2 * ((bit1 >> sq) & 1) + ((bit0 >> sq) & 1);
-}*/
-static Bitboard DOUBLED_PAWNS[2]= {BB_RANK_2 | BB_RANK_3, BB_RANK_7 | BB_RANK_6};
-constexpr Score PassedRank[8] =
-{
-    S(0, 0), S(10, 28), S(17, 33), S(15, 41), S(62, 72), S(168, 177), S(276, 260)
-};
+    double hit_rate() const;
 
-static Score PawnWt[3]= {20,2,5};
-constexpr Score Hanging             = S( 69, 36);
-constexpr Score KnightOnQueen       = S( 16, 11);
-constexpr Score LongDiagonalBishop  = S( 45,  0);
-constexpr Score RestrictedPiece     = S(  7,  7);
-constexpr Score TrappedRook         = S( 55, 13);
-constexpr Score WeakQueenProtection = S( 14,  0);
-constexpr Score WeakQueen           = S( 56, 15);
-Score eval(Board board);
+private:
+    std::vector<EvalCacheEntry> _entries;
+
+    size_t _size = 0;
+};
+EvalCache &thread_eval_cache();
+Value eval(const Board &);
 #endif // EVAL_H_INCLUDED
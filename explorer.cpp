@@ -0,0 +1,192 @@
+#include "explorer.h"
+#include "binary.h"
+#include "polyglot.h"
+#include <fstream>
+#include <stdexcept>
+
+    ExplorerIndex::ExplorerIndex(const std::string &path)
+    {
+        this->open(path);
+    }
+
+    void ExplorerIndex::open(const std::string &path)
+    {
+        /*
+        Maps the index at *path*, closing the previous one.
+
+        :throws: :exc:`std::runtime_error` if the file cannot be opened or
+            is not an explorer index.
+        */
+        this->close();
+        this->_file.open(path);
+        const uint8_t *data = (const uint8_t *)this->_file.data();
+        size_t size = this->_file.size();
+        if (size < EXPLORER_HEADER_SIZE || get_le(data, 4) != EXPLORER_MAGIC || get_le(data + 4, 4) != EXPLORER_VERSION)
+        {
+            this->close();
+            throw std::runtime_error("not an explorer index: " + path);
+        }
+        this->_size = get_le(data + 8, 8);
+        this->_fence_interval = get_le(data + 16, 4);
+        this->_fence_count = this->_fence_interval ? (this->_size + this->_fence_interval - 1) / this->_fence_interval : 0;
+        if (!this->_fence_interval || (size - EXPLORER_HEADER_SIZE) / EXPLORER_RECORD_SIZE < this->_size ||
+            size - EXPLORER_HEADER_SIZE - this->_size * EXPLORER_RECORD_SIZE != this->_fence_count * 8)
+        {
+            this->close();
+            throw std::runtime_error("corrupt explorer index: " + path);
+        }
+        this->_records = data + EXPLORER_HEADER_SIZE;
+        this->_fences = this->_records + this->_size * EXPLORER_RECORD_SIZE;
+    }
+
+    void ExplorerIndex::close()
+    {
+        this->_file.close();
+        this->_records = this->_fences = nullptr;
+        this->_size = this->_fence_count = 0;
+    }
+
+    bool ExplorerIndex::is_open() const
+    {
+        return this->_file.is_open();
+    }
+
+    size_t ExplorerIndex::size() const
+    {
+        /* The number of records: distinct moves in distinct positions. */
+        return this->_size;
+    }
+
+    Bitboard ExplorerIndex::_key(size_t index) const
+    {
+        return get_le(this->_records + index * EXPLORER_RECORD_SIZE, 8);
+    }
+
+    size_t ExplorerIndex::query(const Board &board, ExplorerMove *moves, size_t max_moves) const
+    {
+        /*
+        Writes the moves played in the position of *board* to *moves*, most
+        played first, up to *max_moves* of them.
+
+        Returns the number of moves written.
+        */
+        Bitboard key = board.polyglot_key();
+
+        // The first fence not below *key*: the records of *key* start after
+        // the fence before it and not after it.
+        size_t low = 0, high = this->_fence_count;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            if (get_le(this->_fences + middle * 8, 8) < key)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        size_t first = low ? (low - 1) * this->_fence_interval : 0;
+        size_t last = std::min(low * this->_fence_interval + 1, this->_size);
+        while (first < last)
+        {
+            size_t middle = first + (last - first) / 2;
+            if (this->_key(middle) < key)
+            {
+                first = middle + 1;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+
+        size_t count = 0;
+        for (size_t index = first; index < this->_size && this->_key(index) == key; ++index)
+        {
+            const uint8_t *record = this->_records + index * EXPLORER_RECORD_SIZE;
+            ExplorerMove move;
+            move.move = from_polyglot_move(board, get_le(record + 8, 2));
+            if (!board.is_legal(move.move))
+            {
+                continue;
+            }
+            move.games = get_le(record + 10, 4);
+            uint32_t wins = get_le(record + 14, 4), losses = get_le(record + 22, 4);
+            move.draws = get_le(record + 18, 4);
+            move.white = board.turn == WHITE ? wins : losses;
+            move.black = board.turn == WHITE ? losses : wins;
+
+            // Insertion into the moves so far, most played first.
+            size_t i = count < max_moves ? count++ : count;
+            if (i == max_moves && (!max_moves || moves[i - 1].games >= move.games))
+            {
+                continue;
+            }
+            i -= i == max_moves;
+            for (; i > 0 && moves[i - 1].games < move.games; --i)
+            {
+                moves[i] = moves[i - 1];
+            }
+            moves[i] = move;
+        }
+        return count;
+    }
+
+    MoveCountStats build_explorer_index(const std::string &pgn_path, const std::string &path, const MoveCountOptions &options)
+    {
+        /*
+        Builds an explorer index at *path* from the games of the PGN file at
+        *pgn_path*, counted by :func:`count_pgn_moves()`. See
+        :class:`ExplorerIndex` for the format.
+
+        :throws: :exc:`std::runtime_error` if a file cannot be opened or
+            written.
+        */
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        std::string buffer(EXPLORER_HEADER_SIZE, '\0');
+        out.write(buffer.data(), buffer.size());
+
+        std::string fences;
+        uint64_t records = 0;
+        MoveCountStats stats = count_pgn_moves(pgn_path, [&](const MoveCount *counts, size_t size)
+                                               {
+                                                   buffer.clear();
+                                                   for (size_t i = 0; i < size; ++i, ++records)
+                                                   {
+                                                       if (records % EXPLORER_FENCE_INTERVAL == 0)
+                                                       {
+                                                           put_le(fences, counts[i].key, 8);
+                                                       }
+                                                       put_le(buffer, counts[i].key, 8);
+                                                       put_le(buffer, counts[i].move, 2);
+                                                       put_le(buffer, counts[i].games, 4);
+                                                       put_le(buffer, counts[i].wins, 4);
+                                                       put_le(buffer, counts[i].draws, 4);
+                                                       put_le(buffer, counts[i].losses, 4);
+                                                   }
+                                                   out.write(buffer.data(), buffer.size());
+                                               },
+                                               options);
+        out.write(fences.data(), fences.size());
+
+        buffer.clear();
+        put_le(buffer, EXPLORER_MAGIC, 4);
+        put_le(buffer, EXPLORER_VERSION, 4);
+        put_le(buffer, records, 8);
+        put_le(buffer, EXPLORER_FENCE_INTERVAL, 4);
+        buffer.resize(EXPLORER_HEADER_SIZE, '\0');
+        out.seekp(0);
+        out.write(buffer.data(), buffer.size());
+        out.close();
+        if (!out)
+        {
+            throw std::runtime_error("cannot write " + path);
+        }
+        return stats;
+    }
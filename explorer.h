@@ -0,0 +1,86 @@
+#ifndef EXPLORER_H_INCLUDED
+#define EXPLORER_H_INCLUDED
+#include "movecount.h"
+
+    const uint32_t EXPLORER_MAGIC = 0x58435043;
+    /* ``CPCX`` as the first four bytes of an explorer index. */
+
+    const uint32_t EXPLORER_VERSION = 1;
+
+    const size_t EXPLORER_HEADER_SIZE = 32;
+
+    const size_t EXPLORER_RECORD_SIZE = 26;
+
+    const uint32_t EXPLORER_FENCE_INTERVAL = 128;
+    /* Records per fence: a block of records spans about one page. */
+
+    class ExplorerMove
+    {
+        /* How a move scored in the games of an :class:`ExplorerIndex`. */
+
+    public:
+        Move move = Move::null();
+
+        uint32_t games = 0;
+
+        uint32_t white = 0, draws = 0, black = 0;
+        /* Games won by white, drawn and won by black. Games without a result are in :data:`games` only. */
+    };
+
+    class ExplorerIndex
+    {
+        /*
+        An index of the moves played in a collection of games, built by
+        :func:`build_explorer_index()` and mapped read-only into memory.
+
+        The file is a header, the records sorted by position key and move,
+        and the fences: the key of every
+        :data:`EXPLORER_FENCE_INTERVAL`-th record. All numbers are
+        little-endian.
+
+        - header: ``uint32_t`` :data:`EXPLORER_MAGIC` and
+          :data:`EXPLORER_VERSION`, ``uint64_t`` the number of records,
+          ``uint32_t`` the fence interval, 12 bytes reserved
+        - record: ``uint64_t`` :func:`~Board::polyglot_key()`,
+          ``uint16_t`` :func:`polyglot_move()`, ``uint32_t`` games, wins,
+          draws and losses for the side that played the move
+
+        A query binary searches the fences, which are small and stay in the
+        page cache, then one block of records, so it touches a few pages
+        whatever the size of the file. Queries are const, allocation-free
+        and safe to run concurrently.
+        */
+
+    public:
+        ExplorerIndex() = default;
+
+        ExplorerIndex(const std::string &);
+
+        void open(const std::string &);
+
+        void close();
+
+        bool is_open() const;
+
+        size_t size() const;
+
+        size_t query(const Board &, ExplorerMove *, size_t) const;
+
+    private:
+        MappedFile _file;
+
+        const uint8_t *_records = nullptr;
+
+        size_t _size = 0;
+
+        const uint8_t *_fences = nullptr;
+
+        size_t _fence_count = 0;
+
+        size_t _fence_interval = EXPLORER_FENCE_INTERVAL;
+
+        Bitboard _key(size_t) const;
+    };
+
+    MoveCountStats build_explorer_index(const std::string &, const std::string &, const MoveCountOptions & = MoveCountOptions());
+#endif // EXPLORER_H_INCLUDED
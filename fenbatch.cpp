@@ -0,0 +1,376 @@
+#include "fenbatch.h"
+#include "eval.h"
+#include "nnue.h"
+#include "parallel.h"
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
+    double FenBatchStats::lines_per_second() const
+    {
+        return this->seconds > 0 ? this->lines / this->seconds : 0;
+    }
+
+    int parse_fen_query(const std::string &name)
+    {
+        /*
+        Gets the query named *name* in :data:`FEN_QUERY_NAMES`.
+
+        :throws: :exc:`std::invalid_argument` if there is none.
+        */
+        for (int query = 0; query < int(std::size(FEN_QUERY_NAMES)); ++query)
+        {
+            if (FEN_QUERY_NAMES[query] == name)
+            {
+                return query;
+            }
+        }
+        throw std::invalid_argument("unknown query: " + name);
+    }
+
+    static std::string_view _next_token(std::string_view line, size_t &pos)
+    {
+        // The next word of *line* from *pos*, empty at the end.
+        pos = std::min(line.find_first_not_of(" \t", pos), line.size());
+        size_t end = std::min(line.find_first_of(" \t", pos), line.size());
+        std::string_view token = line.substr(pos, end - pos);
+        pos = end;
+        return token;
+    }
+
+    static void _append_number(std::string &out, long value)
+    {
+        char buffer[24];
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+    }
+
+    static bool _answer(Board &board, std::string_view line, const std::vector<int> &queries, std::string &out)
+    {
+        // Appends the answers for one line without its newline to *out*.
+        // Returns false if the line is answered with an error.
+
+        // The FEN: the board and up to three more fields, then the clocks
+        // if they are numbers. Anything else but "moves" is taken for EPD
+        // operations and ignored.
+        size_t pos = 0, fen_end = 0;
+        std::string_view token = _next_token(line, pos);
+        for (int field = 1; !token.empty() && token != "moves" && field <= 6; ++field)
+        {
+            if (field > 4 && token.find_first_not_of("0123456789") != std::string_view::npos)
+            {
+                break;
+            }
+            fen_end = pos;
+            token = _next_token(line, pos);
+        }
+
+        try
+        {
+            board.set_fen(std::string(line.substr(0, fen_end)));
+            if (!board.is_valid())
+            {
+                throw std::invalid_argument("invalid position");
+            }
+
+            std::string san;
+            if (token == "moves")
+            {
+                for (token = _next_token(line, pos); !token.empty(); token = _next_token(line, pos))
+                {
+                    Move move = board.parse_uci(std::string(token));
+                    if (!san.empty())
+                    {
+                        san.push_back(' ');
+                    }
+                    san += board.san_and_push(move);
+                }
+            }
+
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                if (i)
+                {
+                    out.push_back('\t');
+                }
+                switch (queries[i])
+                {
+                case FEN_QUERY_LEGAL:
+                    _append_number(out, board.generate_legal_moves().size());
+                    break;
+                case FEN_QUERY_CHECK:
+                    out.push_back(board.is_check() ? '1' : '0');
+                    break;
+                case FEN_QUERY_RESULT:
+                    out += board.result();
+                    break;
+                case FEN_QUERY_EVAL:
+                    _append_number(out, Network::enabled && network().loaded() ? thread_nnue().evaluate(board) : eval(board));
+                    break;
+                case FEN_QUERY_SAN:
+                    out += san;
+                    break;
+                }
+            }
+            return true;
+        }
+        catch (const std::exception &error)
+        {
+            out += "error\t";
+            out += error.what();
+            return false;
+        }
+    }
+
+    class _FenBatch
+    {
+        // Lines of input handed to a worker, and its answers.
+
+    public:
+        std::string input;
+
+        std::string output;
+
+        uint64_t lines = 0;
+
+        uint64_t errors = 0;
+    };
+
+    FenBatchStats run_fen_batch(std::istream &in, std::ostream &out, const FenBatchOptions &options)
+    {
+        /*
+        Answers the :data:`~FenBatchOptions::queries` for every line of *in*
+        and writes one line of answers per input line to *out*, in input
+        order, the answers separated by tabs.
+
+        An input line is a FEN or EPD, optionally followed by ``moves`` and
+        moves in UCI notation. The moves are played before the other queries
+        are answered, like in the UCI ``position`` command. EPD operations
+        are ignored. Empty lines are answered with empty lines, and lines
+        that cannot be answered with ``error``, a tab and the reason.
+
+        The calling thread reads *in* in blocks of
+        :data:`~FenBatchOptions::block_size` bytes and cuts them into
+        batches at line ends. Workers answer the batches, each with its own
+        :class:`Board`, and the calling thread collects the answers in order
+        and writes them in chunks of
+        :data:`~FenBatchOptions::output_buffer` bytes.
+
+        An exception thrown by a worker or while reading or writing stops
+        the workers. It is rethrown once they have finished; answers not yet
+        written are dropped.
+
+        :throws: :exc:`std::invalid_argument` if a query is unknown.
+        */
+        for (int query : options.queries)
+        {
+            if (query < 0 || query >= int(std::size(FEN_QUERY_NAMES)))
+            {
+                throw std::invalid_argument("unknown query: " + std::to_string(query));
+            }
+        }
+        auto ts = std::chrono::steady_clock::now();
+        size_t threads = worker_threads(options.threads);
+        size_t queue_size = options.queue_size ? options.queue_size : 4 * threads;
+        size_t batch_size = std::max<size_t>(options.batch_size, 1);
+
+        std::mutex mutex;
+        std::condition_variable work_ready, batch_done;
+        std::deque<std::pair<size_t, _FenBatch>> pending;
+        std::map<size_t, _FenBatch> results;
+        bool finished = false;
+        std::exception_ptr error;
+
+        auto answer_batches = [&]
+        {
+            Board board;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                work_ready.wait(lock, [&]
+                                { return finished || error || !pending.empty(); });
+                if (error || pending.empty())
+                {
+                    return;
+                }
+                auto [index, batch] = std::move(pending.front());
+                pending.pop_front();
+                lock.unlock();
+
+                std::string_view input = batch.input;
+                batch.output.reserve(input.size());
+                for (size_t start = 0; start < input.size();)
+                {
+                    size_t end = std::min(input.find('\n', start), input.size());
+                    std::string_view line = input.substr(start, end - start);
+                    if (!line.empty() && line.back() == '\r')
+                    {
+                        line.remove_suffix(1);
+                    }
+                    if (line.find_first_not_of(" \t") != std::string_view::npos)
+                    {
+                        batch.errors += !_answer(board, line, options.queries, batch.output);
+                    }
+                    batch.output.push_back('\n');
+                    ++batch.lines;
+                    start = end + 1;
+                }
+                std::string().swap(batch.input);
+
+                lock.lock();
+                results.emplace(index, std::move(batch));
+                batch_done.notify_all();
+            }
+        };
+
+        // Keeps the first exception and wakes every thread waiting for work
+        // or answers, so that they stop.
+        auto fail = [&]
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            work_ready.notify_all();
+            batch_done.notify_all();
+        };
+
+        auto work = [&]
+        {
+            try
+            {
+                answer_batches();
+            }
+            catch (...)
+            {
+                fail();
+            }
+        };
+
+        FenBatchStats stats;
+        std::string buffer;
+        buffer.reserve(options.output_buffer + batch_size);
+        size_t next_batch = 0, written = 0;
+
+        // Moves the answers that are next in order to the buffer, waiting
+        // until at most *ahead* batches are outstanding. Called with the
+        // lock held. Throws the exception of a worker.
+        auto collect = [&](std::unique_lock<std::mutex> &lock, size_t ahead)
+        {
+            while (true)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+                auto it = results.find(written);
+                if (it == results.end())
+                {
+                    if (next_batch - written <= ahead)
+                    {
+                        return;
+                    }
+                    batch_done.wait(lock);
+                    continue;
+                }
+                _FenBatch batch = std::move(it->second);
+                results.erase(it);
+                ++written;
+                lock.unlock();
+
+                stats.lines += batch.lines;
+                stats.errors += batch.errors;
+                buffer += batch.output;
+                if (buffer.size() >= options.output_buffer)
+                {
+                    out.write(buffer.data(), buffer.size());
+                    buffer.clear();
+                }
+                lock.lock();
+            }
+        };
+
+        auto submit = [&](std::string input)
+        {
+            _FenBatch batch;
+            batch.input = std::move(input);
+            std::unique_lock<std::mutex> lock(mutex);
+            pending.emplace_back(next_batch++, std::move(batch));
+            work_ready.notify_one();
+            collect(lock, queue_size);
+        };
+
+        auto read_batches = [&]
+        {
+            std::string block(std::max<size_t>(options.block_size, 1), '\0');
+            std::string carry;
+            while (in)
+            {
+                in.read(block.data(), block.size());
+                std::string_view data(block.data(), in.gcount());
+                stats.bytes += data.size();
+                size_t start = 0;
+                while (start < data.size())
+                {
+                    // The first line end after the batch is full.
+                    size_t wanted = carry.size() < batch_size ? batch_size - carry.size() : 1;
+                    size_t end = data.find('\n', std::min(start + wanted - 1, data.size()));
+                    if (end == std::string_view::npos)
+                    {
+                        // An incomplete line, finished by the next block.
+                        carry.append(data.substr(start));
+                        break;
+                    }
+                    carry.append(data.substr(start, end + 1 - start));
+                    submit(std::move(carry));
+                    carry.clear();
+                    start = end + 1;
+                }
+            }
+            if (!carry.empty())
+            {
+                submit(std::move(carry));
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            collect(lock, 0);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(work);
+        }
+
+        try
+        {
+            read_batches();
+        }
+        catch (...)
+        {
+            fail();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            work_ready.notify_all();
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        out.write(buffer.data(), buffer.size());
+        out.flush();
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+        return stats;
+    }
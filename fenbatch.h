@@ -0,0 +1,69 @@
+#ifndef FENBATCH_H_INCLUDED
+#define FENBATCH_H_INCLUDED
+#include "Board.h"
+#include <istream>
+#include <ostream>
+
+    const int FEN_QUERY_LEGAL = 0;
+    /* The number of legal moves. */
+
+    const int FEN_QUERY_CHECK = 1;
+    /* ``1`` if the side to move is in check, else ``0``. */
+
+    const int FEN_QUERY_RESULT = 2;
+    /* The result of :func:`~Board::result()`: ``1-0``, ``0-1``, ``1/2-1/2`` or ``*``. */
+
+    const int FEN_QUERY_EVAL = 3;
+    /* The static evaluation in centipawns, from the point of view of white. */
+
+    const int FEN_QUERY_SAN = 4;
+    /* The moves after ``moves`` in standard algebraic notation, separated by spaces. */
+
+    const std::string FEN_QUERY_NAMES[] = {"legal", "check", "result", "eval", "san"};
+
+    class FenBatchOptions
+    {
+        /* What :func:`run_fen_batch()` answers and how it distributes the work. */
+
+    public:
+        std::vector<int> queries = {FEN_QUERY_LEGAL};
+        /* The fields of every output line, in order. */
+
+        size_t threads = 0;
+        /* Threads answering batches, passed to :func:`worker_threads()`: 0 for as many as the hardware runs. */
+
+        size_t block_size = 1 << 20;
+        /* Bytes read from the input at once. */
+
+        size_t batch_size = 1 << 16;
+        /* Bytes of input per task, rounded up to the next line. */
+
+        size_t queue_size = 0;
+        /* Batches read or being answered ahead of the output; 0 for four times the number of threads. */
+
+        size_t output_buffer = 1 << 20;
+        /* Bytes of answers collected before they are written to the output. */
+    };
+
+    class FenBatchStats
+    {
+        /* Counters of a :func:`run_fen_batch()` call. */
+
+    public:
+        uint64_t lines = 0;
+
+        uint64_t errors = 0;
+        /* Lines answered with ``error``. */
+
+        uint64_t bytes = 0;
+        /* Bytes of input. */
+
+        double seconds = 0;
+
+        double lines_per_second() const;
+    };
+
+    int parse_fen_query(const std::string &);
+
+    FenBatchStats run_fen_batch(std::istream &, std::ostream &, const FenBatchOptions & = FenBatchOptions());
+#endif // FENBATCH_H_INCLUDED
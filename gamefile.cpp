@@ -0,0 +1,356 @@
+#include "gamefile.h"
+#include "binary.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+    static const std::string_view _RESULTS[] = {"*", "1-0", "0-1", "1/2-1/2"};
+
+    static const uint8_t _NULL_MOVE_INDEX = 255;
+
+    std::string_view GameRecord::header(std::string_view name, std::string_view default_value) const
+    {
+        /* The value of the first tag called *name*, or *default_value* if there is none. */
+        for (const auto &[key, value] : this->headers)
+        {
+            if (key == name)
+            {
+                return value;
+            }
+        }
+        return default_value;
+    }
+
+    void GameRecord::start_board(Board &board) const
+    {
+        /* Sets *board* to the starting position of the game, with an empty move stack. */
+        if (this->start)
+        {
+            board.unpack(this->start);
+        }
+        else
+        {
+            board.chess960 = false;
+            board.reset();
+        }
+    }
+
+    Move GameRecord::move(const Board &board, size_t ply) const
+    {
+        /*
+        Decodes the move of *ply* (from 0) in *board*, the position before
+        it.
+
+        :throws: :exc:`std::runtime_error` if a move index is out of range.
+            Move codes are not checked for legality.
+        */
+        if (this->flags & GAME_MOVE_INDICES)
+        {
+            uint8_t index = this->moves[ply];
+            if (index == _NULL_MOVE_INDEX)
+            {
+                return Move::null();
+            }
+            std::vector<Move> legal_moves = board.generate_legal_moves();
+            if (index >= legal_moves.size())
+            {
+                throw std::runtime_error("move index out of range in game at offset " + std::to_string(this->offset));
+            }
+            return legal_moves[index];
+        }
+        return board.decode_move(int(get_le(this->moves + 2 * ply, 2)));
+    }
+
+    void GameRecord::replay(Board &board) const
+    {
+        /* Sets *board* to the starting position and plays all moves of the game. */
+        this->start_board(board);
+        for (size_t ply = 0; ply < this->plies; ++ply)
+        {
+            board.push(this->move(board, ply));
+        }
+    }
+
+    GameReader::GameReader(std::string_view data) : _data(data)
+    {
+        /*
+        :throws: :exc:`std::runtime_error` if *data* does not start with
+            the header of a game file.
+        */
+        const uint8_t *bytes = (const uint8_t *)data.data();
+        if (data.size() < 8 || get_le(bytes, 4) != GAMEFILE_MAGIC || get_le(bytes + 4, 4) != GAMEFILE_VERSION)
+        {
+            throw std::runtime_error("not a game file");
+        }
+        this->_pos = 8;
+    }
+
+    size_t GameReader::offset() const
+    {
+        /* The position after the last game read. */
+        return this->_pos;
+    }
+
+    bool GameReader::next(GameRecord &record)
+    {
+        /*
+        Reads the next game into *record*, reusing its memory.
+
+        Returns ``false`` at the end of the data.
+
+        :throws: :exc:`std::runtime_error` if the record is truncated or
+            malformed.
+        */
+        const std::string_view &data = this->_data;
+        if (this->_pos >= data.size())
+        {
+            return false;
+        }
+        const uint8_t *bytes = (const uint8_t *)data.data();
+        size_t offset = this->_pos;
+        auto corrupt = [&]
+        { return std::runtime_error("corrupt game file at offset " + std::to_string(offset)); };
+
+        if (data.size() - offset < 4)
+        {
+            throw corrupt();
+        }
+        size_t size = get_le(bytes + offset, 4);
+        size_t pos = offset + 4;
+        size_t end = pos + size;
+        if (size < 8 || size > data.size() - pos)
+        {
+            throw corrupt();
+        }
+
+        record.headers.clear();
+        record.offset = offset;
+        record.flags = bytes[pos];
+        if (bytes[pos + 1] > 3)
+        {
+            throw corrupt();
+        }
+        record.result = _RESULTS[bytes[pos + 1]];
+        record.plies = get_le(bytes + pos + 2, 4);
+        size_t tags = get_le(bytes + pos + 6, 2);
+        pos += 8;
+        for (size_t i = 0; i < tags; ++i)
+        {
+            if (end - pos < 1 || end - pos - 1 < bytes[pos] + 2u)
+            {
+                throw corrupt();
+            }
+            std::string_view name = data.substr(pos + 1, bytes[pos]);
+            pos += 1 + name.size();
+            size_t value_size = get_le(bytes + pos, 2);
+            if (end - pos - 2 < value_size)
+            {
+                throw corrupt();
+            }
+            record.headers.emplace_back(name, data.substr(pos + 2, value_size));
+            pos += 2 + value_size;
+        }
+
+        record.start = nullptr;
+        if (!(record.flags & GAME_STANDARD))
+        {
+            if (end - pos < Board::PACKED_SIZE)
+            {
+                throw corrupt();
+            }
+            record.start = bytes + pos;
+            pos += Board::PACKED_SIZE;
+        }
+        size_t move_size = record.flags & GAME_MOVE_INDICES ? 1 : 2;
+        if ((end - pos) != record.plies * move_size)
+        {
+            throw corrupt();
+        }
+        record.moves = bytes + pos;
+        this->_pos = end;
+        return true;
+    }
+
+    GameWriter::GameWriter(std::ostream &out, bool move_indices) : _out(out), _move_indices(move_indices)
+    {
+        /*
+        Writes the file header to *out*. With *move_indices* moves are
+        stored as one byte each, their index into the legal moves, which
+        halves their size but makes reading slower.
+        */
+        put_le(this->_buffer, GAMEFILE_MAGIC, 4);
+        put_le(this->_buffer, GAMEFILE_VERSION, 4);
+        this->_out.write(this->_buffer.data(), this->_buffer.size());
+        this->bytes += this->_buffer.size();
+    }
+
+    void GameWriter::write(const std::vector<std::pair<std::string_view, std::string_view>> &headers, const Board &start, const std::vector<Move> &moves, std::string_view result)
+    {
+        /*
+        Writes a game: its tag pairs, the starting position *start* and the
+        legal *moves* from there. Results other than the four termination
+        markers are written as ``*``.
+
+        :throws: :exc:`std::invalid_argument` if a tag is too long or a move
+            is illegal in move index mode.
+        */
+        std::string &buffer = this->_buffer;
+        buffer.clear();
+        static const Board standard_board;
+        bool standard = start == standard_board && !start.chess960;
+        uint8_t flags = (standard ? GAME_STANDARD : 0) | (this->_move_indices ? GAME_MOVE_INDICES : 0);
+        uint8_t result_code = std::find(std::begin(_RESULTS), std::end(_RESULTS), result) - std::begin(_RESULTS);
+
+        put_le(buffer, 0, 4);
+        put_le(buffer, flags, 1);
+        put_le(buffer, result_code > 3 ? 0 : result_code, 1);
+        put_le(buffer, moves.size(), 4);
+        if (headers.size() > 0xFFFF)
+        {
+            throw std::invalid_argument("too many tag pairs");
+        }
+        put_le(buffer, headers.size(), 2);
+        for (const auto &[name, value] : headers)
+        {
+            if (name.size() > 0xFF || value.size() > 0xFFFF)
+            {
+                throw std::invalid_argument("tag pair too long: " + std::string(name));
+            }
+            put_le(buffer, name.size(), 1);
+            buffer += name;
+            put_le(buffer, value.size(), 2);
+            buffer += value;
+        }
+        if (!standard)
+        {
+            uint8_t packed[Board::PACKED_SIZE];
+            start.pack(packed);
+            buffer.append((const char *)packed, Board::PACKED_SIZE);
+        }
+
+        Board board = start;
+        for (const Move &move : moves)
+        {
+            if (this->_move_indices)
+            {
+                uint8_t index = _NULL_MOVE_INDEX;
+                if (move)
+                {
+                    std::vector<Move> legal_moves = board.generate_legal_moves();
+                    auto it = std::find(legal_moves.begin(), legal_moves.end(), move);
+                    if (it == legal_moves.end())
+                    {
+                        throw std::invalid_argument("illegal move " + move.uci() + " in " + board.fen());
+                    }
+                    index = it - legal_moves.begin();
+                }
+                put_le(buffer, index, 1);
+            }
+            else
+            {
+                put_le(buffer, board.encode_move(move), 2);
+            }
+            board.push(move);
+        }
+
+        put_le((uint8_t *)buffer.data(), buffer.size() - 4, 4);
+        this->_out.write(buffer.data(), buffer.size());
+        this->bytes += buffer.size();
+        ++this->games;
+    }
+
+    PgnStats pgn_to_games(const std::string &pgn_path, const std::string &path, bool move_indices)
+    {
+        /*
+        Converts the PGN file at *pgn_path* to a game file at *path*. Games
+        with an illegal move are written up to the move before it. Comments
+        and variations are dropped.
+
+        Returns the counters of reading the PGN file.
+
+        :throws: :exc:`std::runtime_error` if a file cannot be opened.
+        */
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        GameWriter writer(out, move_indices);
+        return read_pgn_file(pgn_path, [&](const PgnGame &game)
+                             {
+                                 Board start = game.board;
+                                 while (!start.move_stack.empty())
+                                 {
+                                     start.pop();
+                                 }
+                                 writer.write(game.headers, start, game.moves, game.result);
+                                 return true;
+                             });
+    }
+
+    uint64_t games_to_pgn(const std::string &path, const std::string &pgn_path)
+    {
+        /*
+        Converts the game file at *path* to a PGN file at *pgn_path*.
+
+        Returns the number of games.
+
+        :throws: :exc:`std::runtime_error` if a file cannot be opened or the
+            game file is corrupt.
+        */
+        MappedFile file(path, true);
+        std::ofstream out(pgn_path, std::ios::binary);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + pgn_path);
+        }
+        GameReader reader(file.view());
+        GameRecord record;
+        Board board;
+        std::string text;
+        uint64_t games = 0;
+        while (reader.next(record))
+        {
+            text.clear();
+            for (const auto &[name, value] : record.headers)
+            {
+                text += "[";
+                text += name;
+                text += " \"";
+                text += value;
+                text += "\"]\n";
+            }
+            text += "\n";
+
+            // Movetext, wrapped at 80 columns.
+            record.start_board(board);
+            size_t line_start = text.size();
+            auto append = [&](const std::string &token)
+            {
+                if (text.size() > line_start && text.size() - line_start + 1 + token.size() > 80)
+                {
+                    text += "\n";
+                    line_start = text.size();
+                }
+                else if (text.size() > line_start)
+                {
+                    text += " ";
+                }
+                text += token;
+            };
+            for (size_t ply = 0; ply < record.plies; ++ply)
+            {
+                Move move = record.move(board, ply);
+                if (board.turn == WHITE || ply == 0)
+                {
+                    append(std::to_string(board.fullmove_number) + (board.turn == WHITE ? "." : "..."));
+                }
+                append(board.san_and_push(move));
+            }
+            append(std::string(record.result));
+            text += "\n\n";
+            out.write(text.data(), text.size());
+            ++games;
+        }
+        return games;
+    }
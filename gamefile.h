@@ -0,0 +1,111 @@
+#ifndef GAMEFILE_H_INCLUDED
+#define GAMEFILE_H_INCLUDED
+#include "pgn.h"
+#include <ostream>
+
+    const uint32_t GAMEFILE_MAGIC = 0x47435043;
+    /* ``CPCG`` as the first four bytes of a game file. */
+
+    const uint32_t GAMEFILE_VERSION = 1;
+
+    const uint8_t GAME_STANDARD = 1;
+    /* Flag of a standard chess game from the starting position. Other games store their starting position. */
+
+    const uint8_t GAME_MOVE_INDICES = 2;
+    /* Flag of a game whose moves are stored as indices into the legal moves. */
+
+    class GameRecord
+    {
+        /*
+        A game in a game file, read by a :class:`GameReader`. Views and
+        pointers point into the data of the reader.
+
+        A game file is a header of two ``uint32_t``, :data:`GAMEFILE_MAGIC`
+        and :data:`GAMEFILE_VERSION`, then the games. All numbers are
+        little-endian. Each game is
+
+        - ``uint32_t`` the size of the rest of the record, to skip it
+        - ``uint8_t`` flags (:data:`GAME_STANDARD`, ...), ``uint8_t``
+          result (0 ``*``, 1 ``1-0``, 2 ``0-1``, 3 ``1/2-1/2``)
+        - ``uint32_t`` the number of plies, ``uint16_t`` the number of tag
+          pairs
+        - the tag pairs: ``uint8_t`` name size, name, ``uint16_t`` value
+          size, value
+        - the starting position packed by :func:`Board::pack()`, unless the
+          game is :data:`GAME_STANDARD`
+        - the moves: ``uint16_t`` codes of :func:`Board::encode_move()`,
+          or with :data:`GAME_MOVE_INDICES` an ``uint8_t`` index into
+          :func:`~Board::generate_legal_moves()` for each ply
+        */
+
+    public:
+        std::vector<std::pair<std::string_view, std::string_view>> headers;
+
+        uint8_t flags = 0;
+
+        std::string_view result;
+
+        const uint8_t *start = nullptr;
+        /* The packed starting position, ``nullptr`` for the standard one. */
+
+        const uint8_t *moves = nullptr;
+
+        size_t plies = 0;
+
+        size_t offset = 0;
+        /* The position of the record in the data of the reader. */
+
+        std::string_view header(std::string_view, std::string_view = "") const;
+
+        void start_board(Board &) const;
+
+        Move move(const Board &, size_t) const;
+
+        void replay(Board &) const;
+    };
+
+    class GameReader
+    {
+        /*
+        Reads the games of a game file without copying them. See
+        :class:`GameRecord` for the format.
+        */
+
+    public:
+        GameReader(std::string_view);
+
+        bool next(GameRecord &);
+
+        size_t offset() const;
+
+    private:
+        std::string_view _data;
+
+        size_t _pos = 0;
+    };
+
+    class GameWriter
+    {
+        /* Writes games to a stream in the format of :class:`GameRecord`. */
+
+    public:
+        uint64_t games = 0;
+
+        uint64_t bytes = 0;
+
+        GameWriter(std::ostream &, bool = false);
+
+        void write(const std::vector<std::pair<std::string_view, std::string_view>> &, const Board &, const std::vector<Move> &, std::string_view);
+
+    private:
+        std::ostream &_out;
+
+        bool _move_indices;
+
+        std::string _buffer;
+    };
+
+    PgnStats pgn_to_games(const std::string &, const std::string &, bool = false);
+
+    uint64_t games_to_pgn(const std::string &, const std::string &);
+#endif // GAMEFILE_H_INCLUDED
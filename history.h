@@ -0,0 +1,119 @@
+#ifndef HISTORY_H_INCLUDED
+#define HISTORY_H_INCLUDED
+#include "Board.h"
+#include <cstdint>
+#include <cstring>
+
+    const int HISTORY_MAX = 16384;
+    /* Bound of all history entries. Fits an ``int16_t`` with room for one update. */
+
+    const int KILLER_PLIES = 256;
+    /* Number of plies with killer slots. */
+
+    inline int piece_index(PieceType piece_type, Color color)
+    {
+        /* Maps a colored piece to ``0`` - ``11``. */
+        return (piece_type - 1) + 6 * color;
+    }
+
+    inline void update_history(int16_t &entry, int bonus)
+    {
+        /*
+        Gravity update: the entry moves towards the bonus, and the closer it
+        already is to the bound, the smaller the step. Entries saturate at
+        ``HISTORY_MAX`` instead of overflowing and old information decays as
+        new updates arrive.
+        */
+        bonus = std::clamp(bonus, -HISTORY_MAX, HISTORY_MAX);
+        entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+    }
+
+    inline int history_bonus(int depth)
+    {
+        /* The history bonus for a cutoff at the given remaining depth. */
+        return std::min(16 * depth * depth + 32 * depth, 1600);
+    }
+
+    class ButterflyHistory
+    {
+        /*
+        Quiet move history indexed by side to move, source and target square.
+        */
+
+    public:
+        int16_t table[2][64][64];
+
+        ButterflyHistory() { this->clear(); }
+
+        void clear() { std::memset(this->table, 0, sizeof(this->table)); }
+
+        int16_t &at(Color color, const Move &move) { return this->table[color][move.from_square][move.to_square]; }
+
+        int get(Color color, const Move &move) const { return this->table[color][move.from_square][move.to_square]; }
+    };
+
+    class ContinuationHistory
+    {
+        /*
+        Quiet move history indexed by the piece and target square of an
+        earlier move, and the piece and target square of the current move.
+        One table serves every ply distance; the search keeps a pointer to
+        the relevant sub-table per ply.
+        */
+
+    public:
+        typedef int16_t PieceTo[12][64];
+
+        PieceTo table[12][64];
+
+        ContinuationHistory() { this->clear(); }
+
+        void clear() { std::memset(this->table, 0, sizeof(this->table)); }
+
+        PieceTo &at(int piece, Square to_square) { return this->table[piece][to_square]; }
+    };
+
+    class KillerMoves
+    {
+        /*
+        Two killer slots per ply, stored as raw 16-bit moves
+        (:func:`encode_raw_move()`). ``0`` is an empty slot.
+        */
+
+    public:
+        uint16_t table[KILLER_PLIES][2];
+
+        KillerMoves() { this->clear(); }
+
+        void clear() { std::memset(this->table, 0, sizeof(this->table)); }
+
+        void update(int ply, uint16_t move)
+        {
+            if (this->table[ply][0] != move)
+            {
+                this->table[ply][1] = this->table[ply][0];
+                this->table[ply][0] = move;
+            }
+        }
+
+        void clear_ply(int ply) { this->table[ply][0] = this->table[ply][1] = 0; }
+    };
+
+    class CounterMoves
+    {
+        /*
+        The quiet move that last refuted a move, indexed by the piece and
+        target square of the move being refuted. Stored as raw 16-bit moves.
+        */
+
+    public:
+        uint16_t table[12][64];
+
+        CounterMoves() { this->clear(); }
+
+        void clear() { std::memset(this->table, 0, sizeof(this->table)); }
+
+        uint16_t &at(int piece, Square to_square) { return this->table[piece][to_square]; }
+    };
+
+#endif // HISTORY_H_INCLUDED
@@ -3,7 +3,11 @@
 #include <iostream>
 #include "Board.h"
 #include "eval.h"
+#include "bench.h"
+#include "uci.h"
+#include "fenbatch.h"
 #include <chrono>
+#include <iomanip>
 using namespace std;
 void printBitboard(Bitboard bb)
 {
@@ -29,16 +33,139 @@ int perft(Board &board, int depth)
     };
     return count;
 }
-int main()
+int main(int argc, char *argv[])
 {
-    Board board;
-    for (int i=1; i < 7; i++)
+    if (argc > 1 && std::string(argv[1]) == "see")
     {
-        auto ts = std::chrono::steady_clock::now();
-        unsigned long long nodes=perft(board,i);
-        auto te = std::chrono::steady_clock::now();
-        unsigned long long total = std::chrono::duration_cast<std::chrono::nanoseconds>(te - ts).count();
-        cout <<  "Depth " << i << " Time: "<<total/1e9 << "s " << nodes << " " <<setprecision(10)<< ((long double)nodes/total*1000) << " MNPS"<< endl;
+        bench_see();
+        return 0;
     }
+    if (argc > 1 && std::string(argv[1]) == "time")
+    {
+        bench_time(argc > 2 ? std::stoi(argv[2]) : 20);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "eval")
+    {
+        bench_eval(argc > 2 ? std::stoi(argv[2]) : 20);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "nnue")
+    {
+        // e.g. "nnue 5 net.nnue"; a random network without a file.
+        bench_nnue(argc > 2 ? std::stoi(argv[2]) : 5, argc > 3 ? argv[3] : "");
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "pack")
+    {
+        bench_pack(argc > 2 ? std::stoi(argv[2]) : 20);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "features")
+    {
+        bench_features(argc > 2 ? std::stoi(argv[2]) : 20);
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "book")
+    {
+        // e.g. "book games.pgn" builds a book from the games, "book games.pgn book.bin 12" probes an existing one.
+        bench_book(argv[2], argc > 3 ? argv[3] : "", argc > 4 ? std::stoi(argv[4]) : 20);
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "buildbook")
+    {
+        // e.g. "buildbook games.pgn 8 16" builds a 16 ply book on 8 threads.
+        bench_book_build(argv[2], argc > 3 ? std::stoi(argv[3]) : 0, argc > 4 ? std::stoi(argv[4]) : 20);
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "explorer")
+    {
+        // e.g. "explorer games.pgn 30" indexes the first 30 plies of every game.
+        bench_explorer(argv[2], argc > 3 ? std::stoi(argv[3]) : 20);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "selfplay")
+    {
+        // e.g. "selfplay 100 8 5000" plays 100 games on 8 threads at 5000 nodes per move.
+        bench_selfplay(argc > 2 ? std::stoi(argv[2]) : 20, argc > 3 ? std::stoi(argv[3]) : 0, argc > 4 ? std::stoull(argv[4]) : 2000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "batch")
+    {
+        // e.g. "batch legal check eval threads=8 < fens.txt"; the legal move count without queries.
+        FenBatchOptions options;
+        options.queries.clear();
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg.rfind("threads=", 0) == 0)
+            {
+                options.threads = std::stoi(arg.substr(8));
+            }
+            else
+            {
+                options.queries.push_back(parse_fen_query(arg));
+            }
+        }
+        if (options.queries.empty())
+        {
+            options.queries.push_back(FEN_QUERY_LEGAL);
+        }
+        std::ios::sync_with_stdio(false);
+        FenBatchStats stats = run_fen_batch(std::cin, std::cout, options);
+        std::cerr << stats.lines << " lines, " << stats.errors << " errors, " << std::fixed << std::setprecision(0) << stats.lines_per_second() << " lines/s" << std::endl;
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "batchbench")
+    {
+        // e.g. "batchbench 1000000 8".
+        bench_fen_batch(argc > 2 ? std::stoi(argv[2]) : 1000000, argc > 3 ? std::stoi(argv[3]) : 0);
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "games")
+    {
+        // e.g. "games games.pgn indices" to store moves as legal move indices.
+        bench_games(argv[2], argc > 3 && std::string(argv[3]) == "indices");
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "pgn")
+    {
+        // e.g. "pgn games.pgn 8 unordered"; no thread count reads on this thread.
+        bench_pgn(argv[2], argc > 3 ? std::stoi(argv[3]) : 0, !(argc > 4 && std::string(argv[4]) == "unordered"));
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "search")
+    {
+        // e.g. "search 6 no-null no-lmr" to disable single techniques.
+        SearchOptions options;
+        for (int i = 3; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            options.null_move &= arg != "no-null";
+            options.late_move_reductions &= arg != "no-lmr";
+            options.reverse_futility &= arg != "no-rfp";
+            options.futility &= arg != "no-futility";
+            options.check_extensions &= arg != "no-check-ext";
+        }
+        bench_search(argc > 2 ? std::stoi(argv[2]) : 5, options);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "perft")
+    {
+        Board board;
+        int depth = argc > 2 ? std::stoi(argv[2]) : 6;
+        for (int i=1; i <= depth; i++)
+        {
+            auto ts = std::chrono::steady_clock::now();
+            unsigned long long nodes=perft(board,i);
+            auto te = std::chrono::steady_clock::now();
+            unsigned long long total = std::chrono::duration_cast<std::chrono::nanoseconds>(te - ts).count();
+            cout <<  "Depth " << i << " Time: "<<total/1e9 << "s " << nodes << " " <<setprecision(10)<< ((long double)nodes/total*1000) << " MNPS"<< endl;
+        }
+        return 0;
+    }
+    std::ios::sync_with_stdio(false);
+    UCI uci;
+    uci.loop();
     return 0;
 }
@@ -0,0 +1,126 @@
+#include "material.h"
+
+    void MaterialEntry::evaluate(const int counts[2][7])
+    {
+        /* Computes the entry from the number of pieces of each color and type. */
+        int imbalance = (this->_imbalance(counts, WHITE) - this->_imbalance(counts, BLACK)) / 32;
+        this->imbalance = make_score(imbalance, imbalance);
+
+        this->endgame = find_endgame(this->key, this->strong_side);
+
+        this->opposite_bishops = true;
+        for (Color color : {WHITE, BLACK})
+        {
+            this->opposite_bishops &= counts[color][BISHOP] == 1 && !counts[color][KNIGHT] && !counts[color][ROOK] && !counts[color][QUEEN];
+        }
+
+        int white = this->_insufficient(counts, WHITE), black = this->_insufficient(counts, BLACK);
+        this->insufficient = white && black ? std::max(white, black) : 0;
+    }
+
+    int MaterialEntry::_imbalance(const int counts[2][7], Color us)
+    {
+        /*
+        The second-degree polynomial of the piece counts of *us*, with the
+        bishop pair as an extra piece, in 1/32 of the units of the evaluation.
+        */
+        int ours[6] = {counts[us][BISHOP] > 1}, theirs[6] = {counts[!us][BISHOP] > 1};
+        for (PieceType piece_type = PAWN; piece_type <= QUEEN; ++piece_type)
+        {
+            ours[piece_type] = counts[us][piece_type];
+            theirs[piece_type] = counts[!us][piece_type];
+        }
+
+        int bonus = 0;
+        for (int pt1 = 0; pt1 <= QUEEN; ++pt1)
+        {
+            if (!ours[pt1])
+            {
+                continue;
+            }
+            int v = 0;
+            for (int pt2 = 0; pt2 <= pt1; ++pt2)
+            {
+                v += QuadraticOurs[pt1][pt2] * ours[pt2] + QuadraticTheirs[pt1][pt2] * theirs[pt2];
+            }
+            bonus += ours[pt1] * v;
+        }
+        return bonus;
+    }
+
+    int MaterialEntry::_insufficient(const int counts[2][7], Color color)
+    {
+        /*
+        The part of :func:`~Board::has_insufficient_material()` that only
+        depends on the piece counts, see :data:`insufficient`.
+        */
+        const int *ours = counts[color], *theirs = counts[!color];
+        if (ours[PAWN] || ours[ROOK] || ours[QUEEN])
+        {
+            return 0;
+        }
+        if (ours[KNIGHT])
+        {
+            return ours[KNIGHT] + ours[BISHOP] + ours[KING] <= 2 && !theirs[PAWN] && !theirs[KNIGHT] && !theirs[BISHOP] && !theirs[ROOK];
+        }
+        if (ours[BISHOP])
+        {
+            return !theirs[PAWN] && !theirs[KNIGHT] ? 2 : 0;
+        }
+        return 1;
+    }
+
+    bool MaterialEntry::is_insufficient_material(const Board &board) const
+    {
+        /* Same as :func:`~Board::is_insufficient_material()` for a board with this material. */
+        if (this->insufficient == 2)
+        {
+            return !(board.bishops & BB_DARK_SQUARES) || !(board.bishops & BB_LIGHT_SQUARES);
+        }
+        return this->insufficient;
+    }
+
+    MaterialTable::MaterialTable(size_t size)
+    {
+        /* Creates a table with *size* entries, rounded down to a power of two. */
+        this->_entries.resize(std::bit_floor(std::max<size_t>(size, 1)));
+    }
+
+    const MaterialEntry &MaterialTable::probe(const Board &board)
+    {
+        /*
+        Returns the material entry of *board*, computing and storing it if it
+        is not in the table.
+        */
+        MaterialEntry &entry = this->_entries[board.material_key & (this->_entries.size() - 1)];
+        if (entry.key == board.material_key)
+        {
+            ++this->hits;
+            return entry;
+        }
+
+        ++this->misses;
+        entry.key = board.material_key;
+        entry.evaluate(board.piece_count);
+        return entry;
+    }
+
+    void MaterialTable::clear()
+    {
+        /* Forgets all entries and resets the counters. */
+        std::fill(this->_entries.begin(), this->_entries.end(), MaterialEntry());
+        this->hits = this->misses = 0;
+    }
+
+    double MaterialTable::hit_rate() const
+    {
+        uint64_t probes = this->hits + this->misses;
+        return probes ? double(this->hits) / probes : 0;
+    }
+
+    MaterialTable &thread_material_table()
+    {
+        /* The material table of the calling thread. */
+        thread_local MaterialTable table;
+        return table;
+    }
@@ -0,0 +1,95 @@
+#ifndef MATERIAL_H_INCLUDED
+#define MATERIAL_H_INCLUDED
+#include "endgame.h"
+
+    constexpr int QuadraticOurs[6][6] =
+    {
+        // bishop pair, pawn, knight, bishop, rook, queen
+        {1438},
+        {  40,   38},
+        {  32,  255, -62},
+        {   0,  104,   4,    0},
+        { -26,   -2,  47,  105, -208},
+        {-189,   24, 117,  133, -134, -6}
+    };
+
+    constexpr int QuadraticTheirs[6][6] =
+    {
+        {   0},
+        {  36,    0},
+        {   9,   63,   0},
+        {  59,   65,  42,    0},
+        {  46,   39,  24,  -24,    0},
+        {  97,  100, -42,  137,  268,    0}
+    };
+
+    class MaterialEntry
+    {
+        /*
+        What is known about a material signature regardless of where the
+        pieces are: the imbalance, a specialized endgame evaluator, drawish
+        opposite colored bishops and insufficient material.
+
+        Only depends on the piece counts, so it is cached in a
+        :class:`MaterialTable`.
+        */
+
+    public:
+        Bitboard key = 0;
+        /* The :data:`~BaseBoard::material_key` this was computed for. */
+
+        Score imbalance = 0;
+        /* White's material imbalance minus black's, as a packed mg/eg score. */
+
+        EndgameFunction endgame = nullptr;
+        /* The evaluator of a known endgame, or ``nullptr``. */
+
+        Color strong_side = WHITE;
+        /* The side :data:`endgame` assumes to be winning. */
+
+        bool opposite_bishops = false;
+        /* Each side has one bishop and nothing but pawns besides. */
+
+        int insufficient = 0;
+        /*
+        ``0`` if a side can still mate, ``1`` if neither side can and ``2``
+        if neither side can when all bishops are on squares of one color.
+        */
+
+        void evaluate(const int[2][7]);
+
+        bool is_insufficient_material(const Board &) const;
+
+    private:
+        static int _imbalance(const int[2][7], Color);
+
+        static int _insufficient(const int[2][7], Color);
+    };
+
+    class MaterialTable
+    {
+        /*
+        A direct-mapped cache of :class:`MaterialEntry` entries indexed by
+        :data:`~BaseBoard::material_key`. Not thread-safe: every thread uses
+        its own, see :func:`thread_material_table()`.
+        */
+
+    public:
+        uint64_t hits = 0;
+
+        uint64_t misses = 0;
+
+        MaterialTable(size_t = 8192);
+
+        const MaterialEntry &probe(const Board &);
+
+        void clear();
+
+        double hit_rate() const;
+
+    private:
+        std::vector<MaterialEntry> _entries;
+    };
+
+    MaterialTable &thread_material_table();
+#endif // MATERIAL_H_INCLUDED
@@ -0,0 +1,130 @@
+#include "mmap.h"
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+    MappedFile::MappedFile(const std::string &path, bool sequential)
+    {
+        this->open(path, sequential);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        this->close();
+    }
+
+    void MappedFile::open(const std::string &path, bool sequential)
+    {
+        /*
+        Maps the file at *path*, closing the previous one. Pass *sequential*
+        if the file will be read from start to end, so the system reads
+        ahead aggressively.
+
+        Empty files are open with no data.
+
+        :throws: :exc:`std::runtime_error` if the file cannot be opened or
+            mapped.
+        */
+        this->close();
+        void *data = nullptr;
+        size_t size;
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        size = file_size.QuadPart;
+        if (size)
+        {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+        if (size && !data)
+        {
+            throw std::runtime_error("cannot map " + path);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        struct stat st;
+        size = fstat(fd, &st) == 0 ? st.st_size : 0;
+        if (size)
+        {
+            data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("cannot map " + path);
+        }
+        if (data && sequential)
+        {
+            madvise(data, size, MADV_SEQUENTIAL);
+        }
+#endif
+        this->_data = data;
+        this->_size = size;
+        this->_open = true;
+        this->_path = path;
+    }
+
+    void MappedFile::close()
+    {
+        /* Unmaps the file. Pointers into it become invalid. */
+        if (this->_data)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(this->_data);
+#else
+            munmap(this->_data, this->_size);
+#endif
+        }
+        this->_data = nullptr;
+        this->_size = 0;
+        this->_open = false;
+        this->_path.clear();
+    }
+
+    bool MappedFile::is_open() const
+    {
+        return this->_open;
+    }
+
+    const char *MappedFile::data() const
+    {
+        return (const char *)this->_data;
+    }
+
+    size_t MappedFile::size() const
+    {
+        return this->_size;
+    }
+
+    std::string_view MappedFile::view() const
+    {
+        /* The contents of the file. */
+        return std::string_view(this->data(), this->_size);
+    }
+
+    const std::string &MappedFile::path() const
+    {
+        return this->_path;
+    }
@@ -0,0 +1,49 @@
+#ifndef MMAP_H_INCLUDED
+#define MMAP_H_INCLUDED
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+    class MappedFile
+    {
+        /*
+        A file mapped read-only into memory. The pages are loaded on demand
+        and shared with other mappings of the same file, so opening costs no
+        time regardless of the size of the file.
+        */
+
+    public:
+        MappedFile() = default;
+
+        MappedFile(const std::string &, bool = false);
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile();
+
+        void open(const std::string &, bool = false);
+
+        void close();
+
+        bool is_open() const;
+
+        const char *data() const;
+
+        size_t size() const;
+
+        std::string_view view() const;
+
+        const std::string &path() const;
+
+    private:
+        void *_data = nullptr;
+
+        size_t _size = 0;
+
+        bool _open = false;
+
+        std::string _path;
+    };
+#endif // MMAP_H_INCLUDED
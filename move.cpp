@@ -79,7 +79,7 @@
                 throw std::invalid_argument("");
             }
             Square from_square = std::distance(SQUARE_NAMES, it);
-            auto it2 = std::find(std::begin(SQUARE_NAMES), std::end(SQUARE_NAMES), uci.substr(2, 4));
+            auto it2 = std::find(std::begin(SQUARE_NAMES), std::end(SQUARE_NAMES), uci.substr(2, 2));
             if (it2 == std::end(SQUARE_NAMES))
             {
                 throw std::invalid_argument("");
@@ -144,7 +144,7 @@ Move decode_raw_move(int raw_move) {
     int to_square = raw_move & 0x3f;
     int from_square = (raw_move >> 6) & 0x3f;
     int promotion_part = (raw_move >> 12) & 0x7;
-    int promotion = promotion_part ? promotion_part + 1 : 0;
+    int promotion = promotion_part && promotion_part <= 4 ? promotion_part + 1 : 0;
     if (promotion)return Move(from_square, to_square, promotion);
     else return Move(from_square, to_square, std::nullopt);
 }
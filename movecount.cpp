@@ -0,0 +1,350 @@
+#include "movecount.h"
+#include "polyglot.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+    class _MoveKeyHash
+    {
+    public:
+        size_t operator()(const std::pair<Bitboard, uint16_t> &key_move) const
+        {
+            return key_move.first ^ (key_move.second * 0x9E3779B97F4A7C15ULL);
+        }
+    };
+
+    class _MoveShard
+    {
+        // A part of the counts, by the top bits of the key, so workers
+        // merging different positions do not wait for each other.
+
+    public:
+        std::mutex mutex;
+
+        std::unordered_map<std::pair<Bitboard, uint16_t>, MoveCount, _MoveKeyHash> counts;
+    };
+
+    class _MoveRun
+    {
+        // Sorted counts, read from a file spilled to disk in blocks, or
+        // from memory if no file is open.
+
+    public:
+        std::ifstream file;
+
+        std::vector<MoveCount> buffer;
+
+        size_t pos = 0;
+
+        bool next(MoveCount &count)
+        {
+            if (this->pos == this->buffer.size())
+            {
+                if (!this->file.is_open())
+                {
+                    return false;
+                }
+                this->buffer.resize(1 << 16);
+                this->file.read((char *)this->buffer.data(), this->buffer.size() * sizeof(MoveCount));
+                this->buffer.resize(this->file.gcount() / sizeof(MoveCount));
+                this->pos = 0;
+                if (this->buffer.empty())
+                {
+                    return false;
+                }
+            }
+            count = this->buffer[this->pos++];
+            return true;
+        }
+    };
+
+    class _MoveRunFiles
+    {
+        // The paths of the runs spilled to disk, removed when it goes out
+        // of scope so that no exit from count_pgn_moves() leaves them behind.
+
+    public:
+        std::vector<std::string> paths;
+
+        ~_MoveRunFiles()
+        {
+            for (const std::string &path : this->paths)
+            {
+                std::error_code error;
+                std::filesystem::remove(path, error);
+            }
+        }
+    };
+
+    static const size_t _MOVE_SHARDS = 64;
+
+    static const size_t _MOVE_COUNT_MEMORY = 80;
+    // Estimated bytes of a count in a shard, with the hash table overhead.
+
+    MoveCountStats count_pgn_moves(const std::string &pgn_path, const std::function<void(const MoveCount *, size_t)> &visitor, const MoveCountOptions &options)
+    {
+        /*
+        Counts every move played in the first
+        :data:`~MoveCountOptions::plies` of the games of the PGN file at
+        *pgn_path*, with the result of the game for the side that played it,
+        and calls *visitor* on the calling thread with the counts of each
+        position in turn: by key, and by move within a position.
+
+        Worker threads each take a chunk of the file (see
+        :func:`next_game_start()`), replay its games and merge their counts
+        into hash maps sharded by key. When the counts outgrow
+        :data:`~MoveCountOptions::max_memory` they are sorted and spilled to
+        disk as a run. The runs and the counts left in memory are merged
+        into one sorted stream for *visitor*.
+
+        An exception thrown by a worker stops the others from taking more
+        chunks and is rethrown once they have finished.
+
+        :throws: :exc:`std::runtime_error` if a file cannot be opened or
+            written.
+        */
+        auto ts = std::chrono::steady_clock::now();
+        MappedFile file(pgn_path, true);
+        std::string_view text = file.view();
+        size_t threads = worker_threads(options.threads);
+        size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+        std::filesystem::path directory = options.temp_directory.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(options.temp_directory);
+        std::string run_prefix = (directory / ("cppchess-moves-" + std::to_string(std::random_device()()))).string();
+
+        MoveCountStats stats;
+        std::mutex mutex, spill_mutex;
+        size_t next_pos = text.substr(0, 3) == "\xEF\xBB\xBF" ? 3 : 0;
+        std::vector<_MoveShard> shards(_MOVE_SHARDS);
+        std::atomic<size_t> counts = 0;
+        _MoveRunFiles runs;
+        std::exception_ptr error;
+
+        // Moves all counts out of the shards, sorted.
+        auto drain = [&](std::vector<MoveCount> &run)
+        {
+            for (_MoveShard &shard : shards)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (const auto &[key_move, count] : shard.counts)
+                {
+                    run.push_back(count);
+                }
+                counts -= shard.counts.size();
+                std::unordered_map<std::pair<Bitboard, uint16_t>, MoveCount, _MoveKeyHash>().swap(shard.counts);
+            }
+            std::sort(run.begin(), run.end());
+        };
+
+        auto spill = [&]
+        {
+            std::lock_guard<std::mutex> lock(spill_mutex);
+            if (counts * _MOVE_COUNT_MEMORY <= options.max_memory)
+            {
+                return;
+            }
+            std::vector<MoveCount> run;
+            drain(run);
+            std::string path = run_prefix + "." + std::to_string(runs.paths.size()) + ".run";
+            runs.paths.push_back(path);
+            std::ofstream out(path, std::ios::binary);
+            out.write((const char *)run.data(), run.size() * sizeof(MoveCount));
+            if (!out)
+            {
+                throw std::runtime_error("cannot write " + path);
+            }
+            stats.spilled_bytes += run.size() * sizeof(MoveCount);
+        };
+
+        auto count_chunks = [&]
+        {
+            PgnGame game;
+            PgnStats pgn_stats;
+            uint64_t positions = 0;
+            std::vector<MoveCount> local[_MOVE_SHARDS];
+            while (true)
+            {
+                size_t start, end;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (error || next_pos >= text.size())
+                    {
+                        break;
+                    }
+                    start = next_pos;
+                    end = next_game_start(text, std::min(start + chunk_size, text.size()));
+                    next_pos = end;
+                }
+
+                PgnReader reader(text.substr(start, end - start));
+                reader.max_plies = options.plies;
+                while (reader.next(game))
+                {
+                    ++pgn_stats.games;
+                    pgn_stats.errors += !game.error.empty();
+                    pgn_stats.moves += game.moves.size();
+                    std::optional<Color> winner;
+                    bool draw = game.result == "1/2-1/2";
+                    if (game.result == "1-0" || game.result == "0-1")
+                    {
+                        winner = game.result == "1-0" ? WHITE : BLACK;
+                    }
+
+                    // Back from the last replayed move to the start.
+                    Board &board = game.board;
+                    for (size_t ply = game.moves.size(); ply-- > 0;)
+                    {
+                        board.pop();
+                        MoveCount count;
+                        count.key = board.polyglot_key();
+                        count.move = polyglot_move(board, game.moves[ply]);
+                        count.games = 1;
+                        count.wins = winner == board.turn;
+                        count.losses = winner && *winner != board.turn;
+                        count.draws = draw;
+                        local[count.key >> 58].push_back(count);
+                        ++positions;
+                    }
+                }
+                pgn_stats.bytes += end - start;
+
+                for (size_t i = 0; i < _MOVE_SHARDS; ++i)
+                {
+                    if (local[i].empty())
+                    {
+                        continue;
+                    }
+                    std::lock_guard<std::mutex> lock(shards[i].mutex);
+                    size_t size = shards[i].counts.size();
+                    for (const MoveCount &count : local[i])
+                    {
+                        auto [it, inserted] = shards[i].counts.try_emplace({count.key, count.move}, count);
+                        if (!inserted)
+                        {
+                            it->second.add(count);
+                        }
+                    }
+                    counts += shards[i].counts.size() - size;
+                    local[i].clear();
+                }
+                if (counts * _MOVE_COUNT_MEMORY > options.max_memory)
+                {
+                    spill();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.pgn.add(pgn_stats);
+            stats.positions += positions;
+        };
+
+        auto work = [&]
+        {
+            try
+            {
+                count_chunks();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(work);
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        stats.pgn.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+        stats.runs = runs.paths.size();
+
+        // K-way merge of the runs and the counts still in memory.
+        auto merge_ts = std::chrono::steady_clock::now();
+        std::vector<_MoveRun> sources(runs.paths.size() + 1);
+        for (size_t i = 0; i < runs.paths.size(); ++i)
+        {
+            sources[i].file.open(runs.paths[i], std::ios::binary);
+            if (!sources[i].file)
+            {
+                throw std::runtime_error("cannot open " + runs.paths[i]);
+            }
+        }
+        drain(sources.back().buffer);
+
+        std::vector<MoveCount> position;
+        auto visit = [&]
+        {
+            stats.counts += position.size();
+            visitor(position.data(), position.size());
+            position.clear();
+        };
+
+        auto greater = [&](size_t a, size_t b)
+        {
+            return sources[b].buffer[sources[b].pos] < sources[a].buffer[sources[a].pos];
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+        MoveCount count;
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            // Peek at the first count without taking it.
+            if (sources[i].next(count))
+            {
+                --sources[i].pos;
+                queue.push(i);
+            }
+        }
+        while (!queue.empty())
+        {
+            size_t i = queue.top();
+            queue.pop();
+            sources[i].next(count);
+            if (!position.empty() && position.front().key != count.key)
+            {
+                visit();
+            }
+            if (!position.empty() && position.back().move == count.move)
+            {
+                position.back().add(count);
+            }
+            else
+            {
+                position.push_back(count);
+            }
+            if (sources[i].next(count))
+            {
+                --sources[i].pos;
+                queue.push(i);
+            }
+        }
+        if (!position.empty())
+        {
+            visit();
+        }
+        auto now = std::chrono::steady_clock::now();
+        stats.merge_seconds = std::chrono::duration<double>(now - merge_ts).count();
+        stats.seconds = std::chrono::duration<double>(now - ts).count();
+        return stats;
+    }
+
@@ -0,0 +1,84 @@
+#ifndef MOVECOUNT_H_INCLUDED
+#define MOVECOUNT_H_INCLUDED
+#include "pgn.h"
+
+    class MoveCount
+    {
+        /*
+        The games in which a move was played in a position, and how they
+        ended for the side that played it.
+        */
+
+    public:
+        Bitboard key = 0;
+        /* The :func:`~Board::polyglot_key()` of the position. */
+
+        uint16_t move = 0;
+        /* The move, encoded by :func:`polyglot_move()`. */
+
+        uint32_t games = 0, wins = 0, draws = 0, losses = 0;
+        /* Games without a result count in *games* only. */
+
+        bool operator<(const MoveCount &other) const
+        {
+            return this->key < other.key || (this->key == other.key && this->move < other.move);
+        }
+
+        void add(const MoveCount &other)
+        {
+            this->games += other.games;
+            this->wins += other.wins;
+            this->draws += other.draws;
+            this->losses += other.losses;
+        }
+    };
+
+    class MoveCountOptions
+    {
+        /* How :func:`count_pgn_moves()` counts. */
+
+    public:
+        size_t plies = 20;
+        /* Plies of each game that are counted. */
+
+        size_t threads = 0;
+        /* Worker threads; 0 for one per hardware thread. */
+
+        size_t chunk_size = 1 << 20;
+        /* Bytes of PGN per task, rounded up to the next game. */
+
+        size_t max_memory = size_t(512) << 20;
+        /* Bytes of counts to hold in memory before sorted runs are spilled to disk. */
+
+        std::string temp_directory;
+        /* Where runs are spilled; empty for the system temporary directory. */
+    };
+
+    class MoveCountStats
+    {
+        /* Counters of a :func:`count_pgn_moves()` call. */
+
+    public:
+        PgnStats pgn;
+        /* Counters of reading the games. :data:`PgnStats::moves` only counts replayed moves. */
+
+        uint64_t positions = 0;
+        /* Positions counted, one per ply of each game. */
+
+        uint64_t counts = 0;
+        /* Distinct moves in distinct positions. */
+
+        uint64_t runs = 0;
+        /* Sorted runs spilled to disk. */
+
+        uint64_t spilled_bytes = 0;
+
+        double seconds = 0;
+        /* Time for the whole call. */
+
+        double merge_seconds = 0;
+        /* Time for merging and visiting the counts, included in :data:`seconds`. */
+    };
+
+    MoveCountStats count_pgn_moves(const std::string &, const std::function<void(const MoveCount *, size_t)> &, const MoveCountOptions & = MoveCountOptions());
+#endif // MOVECOUNT_H_INCLUDED
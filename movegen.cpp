@@ -80,6 +80,17 @@
 
     std::vector<std::vector<Bitboard>> _rays()
     {
+        // Computed from scratch rather than from the attack tables: _rays() is
+        // also run during static initialization of other translation units,
+        // possibly before the tables in this one are initialized.
+        std::vector<Bitboard> diag, rank, file;
+        for (Square square : SQUARES)
+        {
+            diag.push_back(_sliding_attacks(square, 0, {-9, -7, 7, 9}));
+            rank.push_back(_sliding_attacks(square, 0, {-1, 1}));
+            file.push_back(_sliding_attacks(square, 0, {-8, 8}));
+        }
+
         std::vector<std::vector<Bitboard>> rays;
         for (int a = 0; a < 64; ++a)
         {
@@ -88,17 +99,17 @@
             for (int b = 0; b < 64; ++b)
             {
                 Bitboard bb_b = BB_SQUARES[b];
-                if (BB_DIAG_ATTACKS[a].at(0) & bb_b)
+                if (diag[a] & bb_b)
                 {
-                    rays_row.push_back((BB_DIAG_ATTACKS[a].at(0) & BB_DIAG_ATTACKS[b].at(0)) | bb_a | bb_b);
+                    rays_row.push_back((diag[a] & diag[b]) | bb_a | bb_b);
                 }
-                else if (BB_RANK_ATTACKS[a].at(0) & bb_b)
+                else if (rank[a] & bb_b)
                 {
-                    rays_row.push_back(BB_RANK_ATTACKS[a].at(0) | bb_a);
+                    rays_row.push_back(rank[a] | bb_a);
                 }
-                else if (BB_FILE_ATTACKS[a].at(0) & bb_b)
+                else if (file[a] & bb_b)
                 {
-                    rays_row.push_back(BB_FILE_ATTACKS[a].at(0) | bb_a);
+                    rays_row.push_back(file[a] | bb_a);
                 }
                 else
                 {
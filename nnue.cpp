@@ -0,0 +1,425 @@
+#include "nnue.h"
+#include <cstring>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+    class _Kernels
+    {
+        /*
+        The inner loops of the network. The best implementation for the CPU
+        is selected once at runtime, so one binary runs everywhere.
+        */
+
+    public:
+        const char *name;
+
+        void (*add)(int16_t *, const int16_t *);
+        /* Adds a row of feature weights to an accumulator. */
+
+        void (*sub)(int16_t *, const int16_t *);
+        /* Subtracts a row of feature weights from an accumulator. */
+
+        void (*clip)(const int16_t *, uint8_t *);
+        /* Clips an accumulator to 0..127. */
+
+        int32_t (*dot)(const uint8_t *, const int8_t *, int);
+        /* The dot product of clipped inputs and a row of weights, the size a multiple of 32. */
+    };
+
+    static void _add_scalar(int16_t *accumulator, const int16_t *weights)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            accumulator[i] += weights[i];
+        }
+    }
+
+    static void _sub_scalar(int16_t *accumulator, const int16_t *weights)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            accumulator[i] -= weights[i];
+        }
+    }
+
+    static void _clip_scalar(const int16_t *accumulator, uint8_t *output)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            output[i] = std::clamp<int16_t>(accumulator[i], 0, 127);
+        }
+    }
+
+    static int32_t _dot_scalar(const uint8_t *input, const int8_t *weights, int size)
+    {
+        int32_t sum = 0;
+        for (int i = 0; i < size; ++i)
+        {
+            sum += input[i] * weights[i];
+        }
+        return sum;
+    }
+
+#ifdef NNUE_X86
+    __attribute__((target("avx2"))) static void _add_avx2(int16_t *accumulator, const int16_t *weights)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m256i *a = (__m256i *)(accumulator + i);
+            _mm256_store_si256(a, _mm256_add_epi16(_mm256_load_si256(a), _mm256_loadu_si256((const __m256i *)(weights + i))));
+        }
+    }
+
+    __attribute__((target("avx2"))) static void _sub_avx2(int16_t *accumulator, const int16_t *weights)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m256i *a = (__m256i *)(accumulator + i);
+            _mm256_store_si256(a, _mm256_sub_epi16(_mm256_load_si256(a), _mm256_loadu_si256((const __m256i *)(weights + i))));
+        }
+    }
+
+    __attribute__((target("avx2"))) static void _clip_avx2(const int16_t *accumulator, uint8_t *output)
+    {
+        // Packing saturates to -128..127 but interleaves the 128 bit lanes,
+        // which the permutation puts back in order.
+        const __m256i zero = _mm256_setzero_si256();
+        for (int i = 0; i < NNUE_HIDDEN; i += 32)
+        {
+            __m256i a = _mm256_load_si256((const __m256i *)(accumulator + i));
+            __m256i b = _mm256_load_si256((const __m256i *)(accumulator + i + 16));
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+            _mm256_storeu_si256((__m256i *)(output + i), _mm256_max_epi8(packed, zero));
+        }
+    }
+
+    __attribute__((target("avx2"))) static int32_t _dot_avx2(const uint8_t *input, const int8_t *weights, int size)
+    {
+        // Products of inputs up to 127 and weights fit the saturating
+        // 16 bit sums of pairs.
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < size; i += 32)
+        {
+            __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *)(input + i)), _mm256_loadu_si256((const __m256i *)(weights + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+        return _mm_cvtsi128_si32(sum128);
+    }
+
+    __attribute__((target("sse4.1"))) static void _add_sse41(int16_t *accumulator, const int16_t *weights)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            __m128i *a = (__m128i *)(accumulator + i);
+            _mm_store_si128(a, _mm_add_epi16(_mm_load_si128(a), _mm_loadu_si128((const __m128i *)(weights + i))));
+        }
+    }
+
+    __attribute__((target("sse4.1"))) static void _sub_sse41(int16_t *accumulator, const int16_t *weights)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            __m128i *a = (__m128i *)(accumulator + i);
+            _mm_store_si128(a, _mm_sub_epi16(_mm_load_si128(a), _mm_loadu_si128((const __m128i *)(weights + i))));
+        }
+    }
+
+    __attribute__((target("sse4.1"))) static void _clip_sse41(const int16_t *accumulator, uint8_t *output)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m128i a = _mm_load_si128((const __m128i *)(accumulator + i));
+            __m128i b = _mm_load_si128((const __m128i *)(accumulator + i + 8));
+            _mm_storeu_si128((__m128i *)(output + i), _mm_max_epi8(_mm_packs_epi16(a, b), zero));
+        }
+    }
+
+    __attribute__((target("sse4.1"))) static int32_t _dot_sse41(const uint8_t *input, const int8_t *weights, int size)
+    {
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < size; i += 16)
+        {
+            __m128i products = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(input + i)), _mm_loadu_si128((const __m128i *)(weights + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return _mm_cvtsi128_si32(sum);
+    }
+#endif
+
+    static const _Kernels &_kernels()
+    {
+        static const _Kernels kernels = []
+        {
+#ifdef NNUE_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return _Kernels{"AVX2", _add_avx2, _sub_avx2, _clip_avx2, _dot_avx2};
+            }
+            if (__builtin_cpu_supports("sse4.1"))
+            {
+                return _Kernels{"SSE4.1", _add_sse41, _sub_sse41, _clip_sse41, _dot_sse41};
+            }
+#endif
+            return _Kernels{"scalar", _add_scalar, _sub_scalar, _clip_scalar, _dot_scalar};
+        }();
+        return kernels;
+    }
+
+    const size_t Network::FILE_SIZE = 8 * sizeof(uint32_t) +
+                                      NNUE_HIDDEN * sizeof(int16_t) + size_t(NNUE_FEATURES) * NNUE_HIDDEN * sizeof(int16_t) +
+                                      NNUE_L2 * sizeof(int32_t) + NNUE_L2 * 2 * NNUE_HIDDEN +
+                                      NNUE_L3 * sizeof(int32_t) + NNUE_L3 * NNUE_L2 +
+                                      sizeof(int32_t) + NNUE_L3;
+
+    std::atomic<bool> Network::enabled{false};
+
+    Network::~Network()
+    {
+        this->unload();
+    }
+
+    void Network::load(const std::string &path)
+    {
+        /*
+        Maps the network file at *path*. The weights are used in place, so
+        loading takes no time and threads and processes share the memory.
+
+        :throws: :exc:`std::runtime_error` if the file cannot be mapped or
+            is not a network of this architecture. The previous network is
+            unloaded either way.
+        */
+        this->unload();
+        this->_file.open(path);
+        const char *data = this->_file.data();
+        size_t size = this->_file.size();
+
+        const uint32_t expected[8] = {NNUE_MAGIC, NNUE_VERSION, NNUE_FEATURES, NNUE_HIDDEN, NNUE_L2, NNUE_L3, 0, 0};
+        if (size != FILE_SIZE || std::memcmp(data, expected, sizeof(expected)))
+        {
+            this->unload();
+            throw std::runtime_error(path + " is not a network of this architecture");
+        }
+
+        const char *p = data + sizeof(expected);
+        auto take = [&p](size_t bytes)
+        {
+            const char *array = p;
+            p += bytes;
+            return array;
+        };
+        this->feature_biases = (const int16_t *)take(NNUE_HIDDEN * sizeof(int16_t));
+        this->feature_weights = (const int16_t *)take(size_t(NNUE_FEATURES) * NNUE_HIDDEN * sizeof(int16_t));
+        this->l1_biases = (const int32_t *)take(NNUE_L2 * sizeof(int32_t));
+        this->l1_weights = (const int8_t *)take(NNUE_L2 * 2 * NNUE_HIDDEN);
+        this->l2_biases = (const int32_t *)take(NNUE_L3 * sizeof(int32_t));
+        this->l2_weights = (const int8_t *)take(NNUE_L3 * NNUE_L2);
+        this->output_bias = (const int32_t *)take(sizeof(int32_t));
+        this->output_weights = (const int8_t *)take(NNUE_L3);
+        this->path = path;
+        ++this->generation;
+    }
+
+    void Network::unload()
+    {
+        /* Unmaps the network. Threads must not be evaluating with it. */
+        this->_file.close();
+        this->feature_biases = this->feature_weights = nullptr;
+        this->l1_biases = this->l2_biases = this->output_bias = nullptr;
+        this->l1_weights = this->l2_weights = this->output_weights = nullptr;
+        this->path.clear();
+    }
+
+    bool Network::loaded() const
+    {
+        return this->_file.data();
+    }
+
+    Network &network()
+    {
+        /* The network shared by all threads. */
+        static Network network;
+        return network;
+    }
+
+    static Square _king(const Board &board, Color color)
+    {
+        Bitboard kings = board.kings & board.occupied_co[color];
+        return kings ? lsb(kings) : 0;
+    }
+
+    void NNUE::_refresh(const Board &board, Accumulator &accumulator, Color perspective)
+    {
+        /* Computes the accumulator of *perspective* from scratch. */
+        const Network &net = network();
+        const _Kernels &kernels = _kernels();
+        ++this->refreshes;
+        int16_t *values = accumulator.values[perspective];
+        std::memcpy(values, net.feature_biases, sizeof(accumulator.values[perspective]));
+        Square king = _king(board, perspective);
+        for (Color color : {WHITE, BLACK})
+        {
+            for (PieceType piece_type = PAWN; piece_type < KING; ++piece_type)
+            {
+                for (Bitboard bb = board.pieces_mask(piece_type, color); bb; bb &= bb - 1)
+                {
+                    kernels.add(values, net.feature_weights + size_t(nnue_feature(perspective, king, color, piece_type, lsb(bb))) * NNUE_HIDDEN);
+                }
+            }
+        }
+    }
+
+    const Accumulator &NNUE::_accumulator(const Board &board)
+    {
+        /*
+        Returns the accumulator of *board*. Starts from the closest earlier
+        ply whose accumulator is still valid for the position at that ply
+        and applies the pieces changed since.
+        */
+        const std::vector<_BoardState> &states = board.states();
+        size_t ply = states.size();
+        if (this->_generation != network().generation)
+        {
+            this->clear();
+            this->_generation = network().generation;
+        }
+        if (this->_stack.size() <= ply)
+        {
+            this->_stack.resize(ply + 1);
+        }
+        Accumulator &accumulator = this->_stack[ply];
+        if (accumulator.computed && accumulator.key == board.piece_key)
+        {
+            return accumulator;
+        }
+
+        // Updating costs a few rows per move, a refresh one row per piece.
+        const size_t max_plies = 8;
+        size_t base = ply;
+        for (size_t i = ply; i-- > 0 && ply - i <= max_plies;)
+        {
+            if (states[i].dirty_pieces.size > DirtyPieces::MAX)
+            {
+                break;
+            }
+            if (this->_stack[i].computed && this->_stack[i].key == states[i].piece_key)
+            {
+                base = i;
+                break;
+            }
+        }
+
+        accumulator.key = board.piece_key;
+        accumulator.computed = true;
+        if (base == ply)
+        {
+            this->_refresh(board, accumulator, WHITE);
+            this->_refresh(board, accumulator, BLACK);
+            return accumulator;
+        }
+
+        // A perspective is refreshed if its king moved, every feature of it
+        // changes then.
+        const Network &net = network();
+        const _Kernels &kernels = _kernels();
+        ++this->updates;
+        for (Color perspective : {WHITE, BLACK})
+        {
+            bool king_moved = false;
+            for (size_t i = base; i < ply && !king_moved; ++i)
+            {
+                const DirtyPieces &dirty = states[i].dirty_pieces;
+                for (int j = 0; j < dirty.size; ++j)
+                {
+                    king_moved |= dirty.piece_types[j] == KING && dirty.colors[j] == perspective;
+                }
+            }
+            if (king_moved)
+            {
+                this->_refresh(board, accumulator, perspective);
+                continue;
+            }
+
+            int16_t *values = accumulator.values[perspective];
+            std::memcpy(values, this->_stack[base].values[perspective], sizeof(accumulator.values[perspective]));
+            Square king = _king(board, perspective);
+            for (size_t i = base; i < ply; ++i)
+            {
+                const DirtyPieces &dirty = states[i].dirty_pieces;
+                for (int j = 0; j < dirty.size; ++j)
+                {
+                    if (dirty.piece_types[j] == KING)
+                    {
+                        continue;
+                    }
+                    const int16_t *weights = net.feature_weights + size_t(nnue_feature(perspective, king, dirty.colors[j], dirty.piece_types[j], dirty.squares[j])) * NNUE_HIDDEN;
+                    (dirty.added[j] ? kernels.add : kernels.sub)(values, weights);
+                }
+            }
+        }
+        return accumulator;
+    }
+
+    Value NNUE::evaluate(const Board &board)
+    {
+        /*
+        Evaluates *board* from the point of view of white, like
+        :func:`eval()`. Requires a loaded :func:`network()`.
+        */
+        const Network &net = network();
+        const _Kernels &kernels = _kernels();
+        const Accumulator &accumulator = this->_accumulator(board);
+
+        // The side to move comes first.
+        alignas(64) uint8_t input[2 * NNUE_HIDDEN];
+        kernels.clip(accumulator.values[board.turn], input);
+        kernels.clip(accumulator.values[!board.turn], input + NNUE_HIDDEN);
+
+        alignas(64) uint8_t hidden1[NNUE_L2];
+        for (int i = 0; i < NNUE_L2; ++i)
+        {
+            int32_t sum = net.l1_biases[i] + kernels.dot(input, net.l1_weights + i * 2 * NNUE_HIDDEN, 2 * NNUE_HIDDEN);
+            hidden1[i] = std::clamp(sum >> 6, 0, 127);
+        }
+
+        alignas(64) uint8_t hidden2[NNUE_L3];
+        for (int i = 0; i < NNUE_L3; ++i)
+        {
+            int32_t sum = net.l2_biases[i] + kernels.dot(hidden1, net.l2_weights + i * NNUE_L2, NNUE_L2);
+            hidden2[i] = std::clamp(sum >> 6, 0, 127);
+        }
+
+        Value value = (net.output_bias[0] + kernels.dot(hidden2, net.output_weights, NNUE_L3)) / 16;
+        return board.turn == WHITE ? value : -value;
+    }
+
+    void NNUE::clear()
+    {
+        /* Forgets all accumulators and resets the counters, e.g., after loading another network. */
+        this->_stack.clear();
+        this->refreshes = this->updates = 0;
+    }
+
+    const char *NNUE::simd()
+    {
+        /* The name of the instruction set the network runs with. */
+        return _kernels().name;
+    }
+
+    NNUE &thread_nnue()
+    {
+        /* The evaluator of the calling thread. */
+        thread_local NNUE nnue;
+        return nnue;
+    }
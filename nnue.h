@@ -0,0 +1,151 @@
+#ifndef NNUE_H_INCLUDED
+#define NNUE_H_INCLUDED
+#include "eval.h"
+#include "mmap.h"
+
+    const int NNUE_FEATURES = 64 * 10 * 64;
+    /* HalfKP: own king square x piece (type and color, kings excluded) x square. */
+
+    const int NNUE_HIDDEN = 256;
+    /* The size of the accumulator of each side. */
+
+    const int NNUE_L2 = 32;
+
+    const int NNUE_L3 = 32;
+
+    inline int nnue_feature(Color perspective, Square king, Color color, PieceType piece_type, Square square)
+    {
+        /*
+        The HalfKP index of a piece other than a king, seen by *perspective*
+        with its king on *king*. Both perspectives see the board from their
+        own side.
+        */
+        int flip = perspective == WHITE ? 0 : 0x38;
+        int piece = 2 * (piece_type - 1) + (color != perspective);
+        return (((king ^ flip) * 10 + piece) << 6) | (square ^ flip);
+    }
+
+    const uint32_t NNUE_MAGIC = 0x45554E4E;
+    /* ``NNUE`` as the first four bytes of a network file. */
+
+    const uint32_t NNUE_VERSION = 1;
+
+    class Network
+    {
+        /*
+        The weights of an efficiently updatable neural network, mapped
+        read-only from a file and shared by all threads.
+
+        The network is 2 x HalfKP[40960] -> 256, then 512 -> 32 -> 32 -> 1.
+        The file is little-endian: a header of eight ``uint32_t`` (magic,
+        version, 40960, 256, 32, 32, 0, 0), then
+
+        - feature biases ``int16_t[256]`` and weights ``int16_t[40960][256]``
+        - hidden layer 1 biases ``int32_t[32]`` and weights ``int8_t[32][512]``
+        - hidden layer 2 biases ``int32_t[32]`` and weights ``int8_t[32][32]``
+        - output bias ``int32_t[1]`` and weights ``int8_t[32]``
+
+        Hidden layer inputs are clipped to 0..127, outputs are divided by 64
+        and the output by 16 to get centipawns from the point of view of the
+        side to move.
+        */
+
+    public:
+        const int16_t *feature_biases = nullptr;
+
+        const int16_t *feature_weights = nullptr;
+
+        const int32_t *l1_biases = nullptr;
+
+        const int8_t *l1_weights = nullptr;
+
+        const int32_t *l2_biases = nullptr;
+
+        const int8_t *l2_weights = nullptr;
+
+        const int32_t *output_bias = nullptr;
+
+        const int8_t *output_weights = nullptr;
+
+        std::string path;
+        /* The loaded file, empty if none is. */
+
+        uint64_t generation = 0;
+        /* Incremented by every :func:`load()`, so evaluators know when their accumulators are stale. */
+
+        static const size_t FILE_SIZE;
+
+        static std::atomic<bool> enabled;
+        /* Whether the search evaluates with :func:`NNUE::evaluate()` instead of :func:`eval()`. */
+
+        Network() = default;
+
+        Network(const Network &) = delete;
+
+        Network &operator=(const Network &) = delete;
+
+        ~Network();
+
+        void load(const std::string &);
+
+        void unload();
+
+        bool loaded() const;
+
+    private:
+        MappedFile _file;
+    };
+
+    Network &network();
+
+    class Accumulator
+    {
+        /*
+        The first layer of the network for both perspectives: the feature
+        biases plus the weights of all active features.
+        */
+
+    public:
+        alignas(64) int16_t values[2][NNUE_HIDDEN];
+
+        Bitboard key = 0;
+        /* The :data:`~BaseBoard::piece_key` of the position. */
+
+        bool computed = false;
+    };
+
+    class NNUE
+    {
+        /*
+        Evaluates positions with the :func:`network()`. Keeps a stack of
+        accumulators indexed by ply, i.e., the size of the move stack, and
+        updates them from the pieces changed by each move (see
+        :data:`_BoardState::dirty_pieces`) instead of summing all features
+        again. A perspective is only refreshed when its king moves.
+
+        Not thread-safe: every thread uses its own, see :func:`thread_nnue()`.
+        */
+
+    public:
+        uint64_t refreshes = 0;
+
+        uint64_t updates = 0;
+
+        Value evaluate(const Board &);
+
+        void clear();
+
+        static const char *simd();
+
+    private:
+        std::vector<Accumulator> _stack;
+
+        uint64_t _generation = 0;
+
+        const Accumulator &_accumulator(const Board &);
+
+        void _refresh(const Board &, Accumulator &, Color);
+    };
+
+    NNUE &thread_nnue();
+#endif // NNUE_H_INCLUDED
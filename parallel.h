@@ -0,0 +1,14 @@
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+#include <algorithm>
+#include <thread>
+
+    inline size_t worker_threads(size_t threads)
+    {
+        /*
+        The number of worker threads for a *threads* option: *threads*, or
+        one per hardware thread if it is 0.
+        */
+        return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+#endif // PARALLEL_H_INCLUDED
@@ -0,0 +1,119 @@
+#include "pawns.h"
+
+    void PawnStructure::evaluate(Bitboard white_pawns, Bitboard black_pawns)
+    {
+        /* Computes the pawn sets and the score from the pawns of both colors. */
+        this->attacks[WHITE] = pawn_attacks_bb(white_pawns, WHITE);
+        this->attacks[BLACK] = pawn_attacks_bb(black_pawns, BLACK);
+        this->score = this->_evaluate(WHITE, white_pawns, black_pawns) - this->_evaluate(BLACK, black_pawns, white_pawns);
+    }
+
+    Score PawnStructure::_evaluate(Color us, Bitboard ours, Bitboard theirs)
+    {
+        Color them = !us;
+
+        // Squares in front of the opposing pawns, from their point of view,
+        // on their own and the adjacent files. A pawn outside of this span
+        // cannot be stopped by a pawn.
+        Bitboard their_front = fill_forward(shift_forward(theirs, them), them);
+        Bitboard their_span = their_front | shift_east(their_front) | shift_west(their_front);
+        Bitboard our_behind = fill_forward(shift_forward(ours, them), them);
+
+        Bitboard opposed = ours & their_front;
+        Bitboard files = file_fill(ours);
+        Bitboard phalanx = ours & (shift_east(ours) | shift_west(ours));
+        Bitboard supported_east = ours & shift_forward(shift_east(ours), us);
+        Bitboard supported_west = ours & shift_forward(shift_west(ours), us);
+
+        this->passed[us] = ours & ~their_span & ~our_behind;
+        Bitboard isolated = ours & ~(shift_east(files) | shift_west(files));
+        Bitboard doubled = ours & fill_forward(shift_forward(ours, us), us);
+        Bitboard connected = phalanx | supported_east | supported_west;
+
+        // A pawn is backward if its stop square is attacked by a pawn and no
+        // friendly pawn can ever defend it.
+        Bitboard support_span = fill_forward(this->attacks[us], us);
+        Bitboard backward = ours & shift_forward(shift_forward(ours, us) & this->attacks[them] & ~support_span, them) & ~isolated;
+
+        // Candidates: not passed, no opposing pawn in front on the file, and
+        // at least as many helpers on the adjacent files as sentries in front.
+        Bitboard candidates = 0;
+        for (Bitboard bb = ours & ~opposed & ~this->passed[us] & ~our_behind; bb; bb &= bb - 1)
+        {
+            Square square = lsb(bb);
+            Bitboard adjacent = shift_east(BB_FILES[square_file(square)]) | shift_west(BB_FILES[square_file(square)]);
+            Bitboard front = fill_forward(shift_forward(BB_RANKS[square_rank(square)], us), us);
+            int sentries = popcount(theirs & adjacent & front);
+            int helpers = popcount(ours & adjacent & ~front);
+            if (helpers >= sentries)
+            {
+                candidates |= BB_SQUARES[square];
+            }
+        }
+
+        Score score = 0;
+        score -= Isolated * popcount(isolated);
+        score -= Doubled * popcount(doubled);
+        score -= Backward * popcount(backward);
+        for (int rank = 1; rank < 7; ++rank)
+        {
+            Bitboard rank_bb = relative_rank_bb(us, rank);
+            score += PassedRank[rank] * popcount(this->passed[us] & rank_bb);
+            score += CandidatePassed[rank] * popcount(candidates & rank_bb);
+
+            // Connected pawns, more for phalanxes and supporters, less when opposed.
+            Bitboard connected_rank = connected & rank_bb;
+            if (connected_rank)
+            {
+                int v = Connected[rank] * (2 * popcount(connected_rank) + popcount(phalanx & rank_bb) - popcount(connected_rank & opposed)) +
+                        21 * (popcount(supported_east & rank_bb) + popcount(supported_west & rank_bb));
+                score += make_score(v, v * (rank - 2) / 4);
+            }
+        }
+        return score;
+    }
+
+    PawnTable::PawnTable(size_t size)
+    {
+        /* Creates a table with *size* entries, rounded down to a power of two. */
+        this->_entries.resize(std::bit_floor(std::max<size_t>(size, 1)));
+    }
+
+    const PawnStructure &PawnTable::probe(const Board &board)
+    {
+        /*
+        Returns the pawn structure of *board*, computing and storing it if it
+        is not in the table.
+        */
+        PawnStructure &entry = this->_entries[board.pawn_key & (this->_entries.size() - 1)];
+        if (entry.key == board.pawn_key)
+        {
+            ++this->hits;
+            return entry;
+        }
+
+        ++this->misses;
+        entry.key = board.pawn_key;
+        entry.evaluate(board.pieces_mask(PAWN, WHITE), board.pieces_mask(PAWN, BLACK));
+        return entry;
+    }
+
+    void PawnTable::clear()
+    {
+        /* Forgets all entries and resets the counters. */
+        std::fill(this->_entries.begin(), this->_entries.end(), PawnStructure());
+        this->hits = this->misses = 0;
+    }
+
+    double PawnTable::hit_rate() const
+    {
+        uint64_t probes = this->hits + this->misses;
+        return probes ? double(this->hits) / probes : 0;
+    }
+
+    PawnTable &thread_pawn_table()
+    {
+        /* The pawn table of the calling thread. */
+        thread_local PawnTable table;
+        return table;
+    }
@@ -0,0 +1,117 @@
+#ifndef PAWNS_H_INCLUDED
+#define PAWNS_H_INCLUDED
+#include "eval.h"
+
+    inline Bitboard shift_forward(Bitboard bb, Color color)
+    {
+        /* Shifts one rank towards the promotion rank of *color*. */
+        return color == WHITE ? bb << 8 : bb >> 8;
+    }
+
+    inline Bitboard shift_east(Bitboard bb)
+    {
+        return (bb & ~BB_FILE_H) << 1;
+    }
+
+    inline Bitboard shift_west(Bitboard bb)
+    {
+        return (bb & ~BB_FILE_A) >> 1;
+    }
+
+    inline Bitboard fill_forward(Bitboard bb, Color color)
+    {
+        /* The squares of *bb* and all squares in front of them, from the point of view of *color*. */
+        if (color == WHITE)
+        {
+            bb |= bb << 8;
+            bb |= bb << 16;
+            return bb | bb << 32;
+        }
+        bb |= bb >> 8;
+        bb |= bb >> 16;
+        return bb | bb >> 32;
+    }
+
+    inline Bitboard file_fill(Bitboard bb)
+    {
+        /* The files of all squares of *bb*. */
+        return fill_forward(bb, WHITE) | fill_forward(bb, BLACK);
+    }
+
+    inline Bitboard pawn_attacks_bb(Bitboard pawns, Color color)
+    {
+        /* All squares attacked by *pawns* of *color*. */
+        return shift_forward(shift_east(pawns) | shift_west(pawns), color);
+    }
+
+    inline Bitboard relative_rank_bb(Color color, int rank)
+    {
+        return BB_RANKS[color == WHITE ? rank : 7 - rank];
+    }
+
+    constexpr Score Isolated = S(5, 15);
+    constexpr Score Backward = S(9, 24);
+    constexpr Score Doubled = S(11, 56);
+    constexpr int Connected[8] = {0, 7, 8, 12, 29, 48, 86, 0};
+    constexpr Score CandidatePassed[8] =
+    {
+        S(0, 0), S(5, 14), S(8, 16), S(7, 20), S(31, 36), S(84, 88), S(0, 0), S(0, 0)
+    };
+
+    class PawnStructure
+    {
+        /*
+        The pawn structure of a position, computed setwise from the two pawn
+        bitboards with fills and shifts: passed, isolated, doubled, backward,
+        connected and candidate passed pawns.
+
+        Only depends on the pawns, so it is cached in a :class:`PawnTable`
+        with the sets that other evaluation terms reuse.
+        */
+
+    public:
+        Bitboard key = 0;
+        /* The :data:`~BaseBoard::pawn_key` of the pawns this was computed for. */
+
+        Score score = 0;
+        /* White's pawn structure minus black's, as a packed mg/eg score. */
+
+        Bitboard attacks[2] = {0, 0};
+        /* Squares attacked by the pawns of each color. */
+
+        Bitboard passed[2] = {0, 0};
+        /* Pawns with no opposing pawn in front of them on the same or an adjacent file. */
+
+        void evaluate(Bitboard, Bitboard);
+
+    private:
+        Score _evaluate(Color, Bitboard, Bitboard);
+    };
+
+    class PawnTable
+    {
+        /*
+        A direct-mapped cache of :class:`PawnStructure` entries indexed by
+        :data:`~BaseBoard::pawn_key`. Not thread-safe: every thread uses its
+        own, see :func:`thread_pawn_table()`.
+        */
+
+    public:
+        uint64_t hits = 0;
+
+        uint64_t misses = 0;
+
+        PawnTable(size_t = 16384);
+
+        const PawnStructure &probe(const Board &);
+
+        void clear();
+
+        double hit_rate() const;
+
+    private:
+        std::vector<PawnStructure> _entries;
+    };
+
+    PawnTable &thread_pawn_table();
+#endif // PAWNS_H_INCLUDED
@@ -0,0 +1,745 @@
+#include "pgn.h"
+#include "movegen.h"
+#include "parallel.h"
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
+    std::string_view PgnGame::header(std::string_view name, std::string_view default_value) const
+    {
+        /* The value of the first tag called *name*, or *default_value* if there is none. */
+        for (const auto &[key, value] : this->headers)
+        {
+            if (key == name)
+            {
+                return value;
+            }
+        }
+        return default_value;
+    }
+
+    void PgnGame::clear()
+    {
+        /* Forgets the previous game but keeps the memory of its containers. */
+        this->headers.clear();
+        this->moves.clear();
+        this->comments.clear();
+        this->nags.clear();
+        this->variations = 0;
+        this->result = {};
+        this->text = {};
+        this->offset = 0;
+        this->error.clear();
+    }
+
+    double PgnStats::games_per_second() const
+    {
+        return this->seconds > 0 ? this->games / this->seconds : 0.0;
+    }
+
+    double PgnStats::mb_per_second() const
+    {
+        return this->seconds > 0 ? this->bytes / this->seconds / (1024 * 1024) : 0.0;
+    }
+
+    void PgnStats::add(const PgnStats &other)
+    {
+        /* Adds the counters of *other*, but not its time. */
+        this->games += other.games;
+        this->errors += other.errors;
+        this->moves += other.moves;
+        this->bytes += other.bytes;
+    }
+
+    static bool _is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static bool _is_delimiter(char c)
+    {
+        // Characters that end a SAN token or a move number without a space.
+        return _is_space(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == ';' || c == '$';
+    }
+
+    static bool _is_result(std::string_view token)
+    {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+
+    static int _suffix_nag(std::string_view suffix)
+    {
+        // The standard NAGs of move suffix annotations, 0 for unknown ones.
+        return suffix == "!" ? 1 : suffix == "?" ? 2 : suffix == "!!" ? 3 : suffix == "??" ? 4 : suffix == "!?" ? 5 : suffix == "?!" ? 6 : 0;
+    }
+
+    Move resolve_san(Board &board, std::string_view san)
+    {
+        /*
+        Parses a move in standard algebraic notation like
+        :func:`~Board::parse_san()`, but finds the moving piece directly with
+        the attack tables instead of generating all legal moves and without
+        copying the token. Moves it cannot resolve unambiguously, castling
+        and null moves are left to :func:`~Board::parse_san()`, which also
+        produces its errors.
+
+        :throws: :exc:`std::invalid_argument` if the SAN is invalid, illegal or ambiguous.
+        */
+        auto fallback = [&]
+        { return board.parse_san(std::string(san)); };
+
+        std::string_view s = san;
+        while (!s.empty() && (s.back() == '+' || s.back() == '#'))
+        {
+            s.remove_suffix(1);
+        }
+        if (s.size() < 2 || s.front() == 'O' || s.front() == '0')
+        {
+            return fallback();
+        }
+
+        std::optional<PieceType> promotion;
+        if (std::string_view("NBRQnbrq").find(s.back()) != std::string_view::npos)
+        {
+            promotion = std::string_view(" pnbrqk").find(std::tolower(s.back()));
+            s.remove_suffix(1);
+            if (!s.empty() && s.back() == '=')
+            {
+                s.remove_suffix(1);
+            }
+        }
+
+        PieceType piece_type = PAWN;
+        if (std::string_view("NBRQK").find(s.front()) != std::string_view::npos)
+        {
+            piece_type = std::string_view(" pnbrqk").find(std::tolower(s.front()));
+            s.remove_prefix(1);
+        }
+
+        if (s.size() < 2 || s[s.size() - 2] < 'a' || s[s.size() - 2] > 'h' || s.back() < '1' || s.back() > '8')
+        {
+            return fallback();
+        }
+        Square to_square = square(s[s.size() - 2] - 'a', s.back() - '1');
+        s.remove_suffix(2);
+
+        // Disambiguation, capture and long algebraic separators.
+        Bitboard from_mask = BB_ALL;
+        int from_file = -1;
+        bool capture = false;
+        for (char c : s)
+        {
+            if (c >= 'a' && c <= 'h')
+            {
+                from_file = c - 'a';
+                from_mask &= BB_FILES[from_file];
+            }
+            else if (c >= '1' && c <= '8')
+            {
+                from_mask &= BB_RANKS[c - '1'];
+            }
+            else if (c == 'x')
+            {
+                capture = true;
+            }
+            else if (c != '-')
+            {
+                return fallback();
+            }
+        }
+
+        Bitboard to_mask = BB_SQUARES[to_square];
+        Bitboard ours = board.occupied_co[board.turn];
+        if (to_mask & ours)
+        {
+            return fallback();
+        }
+
+        Bitboard candidates;
+        if (piece_type == PAWN)
+        {
+            bool last_rank = square_rank(to_square) == (board.turn == WHITE ? 7 : 0);
+            if (last_rank != bool(promotion))
+            {
+                return fallback();
+            }
+            if (from_file >= 0 && from_file != square_file(to_square))
+            {
+                bool ep = board.ep_square == to_square;
+                if (!(to_mask & board.occupied_co[!board.turn]) && !ep)
+                {
+                    return fallback();
+                }
+                candidates = BB_PAWN_ATTACKS[!board.turn][to_square];
+            }
+            else
+            {
+                if (capture || (to_mask & board.occupied))
+                {
+                    return fallback();
+                }
+                int forward = board.turn == WHITE ? 8 : -8;
+                int from_square = to_square - forward;
+                if (from_square < 0 || from_square > 63)
+                {
+                    return fallback();
+                }
+                candidates = BB_SQUARES[from_square];
+                if (!(board.pawns & ours & candidates) && square_rank(to_square) == (board.turn == WHITE ? 3 : 4) && !(board.occupied & candidates))
+                {
+                    candidates = BB_SQUARES[from_square - forward];
+                }
+            }
+        }
+        else if (promotion)
+        {
+            return fallback();
+        }
+        else if (piece_type == KNIGHT)
+        {
+            candidates = BB_KNIGHT_ATTACKS[to_square];
+        }
+        else if (piece_type == KING)
+        {
+            candidates = BB_KING_ATTACKS[to_square];
+        }
+        else
+        {
+            candidates = 0;
+            if (piece_type != ROOK)
+            {
+                candidates |= BB_DIAG_ATTACKS[to_square].at(BB_DIAG_MASKS[to_square] & board.occupied);
+            }
+            if (piece_type != BISHOP)
+            {
+                candidates |= BB_RANK_ATTACKS[to_square].at(BB_RANK_MASKS[to_square] & board.occupied) |
+                              BB_FILE_ATTACKS[to_square].at(BB_FILE_MASKS[to_square] & board.occupied);
+            }
+        }
+        candidates &= board.pieces_mask(piece_type, board.turn) & from_mask;
+
+        // Every candidate is pseudo-legal, only pins and checks can rule it out.
+        std::optional<Move> matched_move;
+        for (; candidates; candidates &= candidates - 1)
+        {
+            Move move(lsb(candidates), to_square, promotion);
+            if (board.is_into_check(move))
+            {
+                continue;
+            }
+            if (matched_move)
+            {
+                return fallback();
+            }
+            matched_move = move;
+        }
+        return matched_move ? *matched_move : fallback();
+    }
+
+    PgnReader::PgnReader(std::string_view text) : _text(text)
+    {
+        // Skip a UTF-8 byte order mark.
+        if (this->_text.substr(0, 3) == "\xEF\xBB\xBF")
+        {
+            this->_pos = 3;
+        }
+    }
+
+    size_t PgnReader::offset() const
+    {
+        /* The position after the last game read. */
+        return this->_pos;
+    }
+
+    bool PgnReader::_read_header(PgnGame &game)
+    {
+        // [Name "Value"] at the current position, which is a '['.
+        const std::string_view &text = this->_text;
+        size_t pos = this->_pos + 1;
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+        {
+            ++pos;
+        }
+        size_t name_start = pos;
+        while (pos < text.size() && !_is_space(text[pos]) && text[pos] != '"' && text[pos] != ']')
+        {
+            ++pos;
+        }
+        std::string_view name = text.substr(name_start, pos - name_start);
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+        {
+            ++pos;
+        }
+        if (name.empty() || pos >= text.size() || text[pos] != '"')
+        {
+            return false;
+        }
+        size_t value_start = ++pos;
+        while (pos < text.size() && text[pos] != '"' && text[pos] != '\n')
+        {
+            pos += text[pos] == '\\' ? 2 : 1;
+        }
+        if (pos >= text.size() || text[pos] != '"')
+        {
+            return false;
+        }
+        std::string_view value = text.substr(value_start, pos - value_start);
+        ++pos;
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+        {
+            ++pos;
+        }
+        if (pos >= text.size() || text[pos] != ']')
+        {
+            return false;
+        }
+        game.headers.emplace_back(name, value);
+        this->_pos = pos + 1;
+        return true;
+    }
+
+    void PgnReader::_play(PgnGame &game, std::string_view san)
+    {
+        try
+        {
+            Move move = resolve_san(game.board, san);
+            game.board.push(move);
+            game.moves.push_back(move);
+        }
+        catch (const std::invalid_argument &error)
+        {
+            game.error = error.what();
+        }
+    }
+
+    bool PgnReader::next(PgnGame &game)
+    {
+        /*
+        Reads the next game into *game*, reusing its memory.
+
+        Returns ``false`` at the end of the text.
+        */
+        const std::string_view &text = this->_text;
+        size_t &pos = this->_pos;
+        game.clear();
+        while (pos < text.size() && _is_space(text[pos]))
+        {
+            ++pos;
+        }
+        if (pos >= text.size())
+        {
+            return false;
+        }
+        size_t start = pos;
+
+        // Tag pairs. Lines that are not are skipped, like escaped lines.
+        while (pos < text.size())
+        {
+            if (_is_space(text[pos]))
+            {
+                ++pos;
+            }
+            else if (text[pos] == '%' || text[pos] == '[')
+            {
+                if (text[pos] == '%' || !this->_read_header(game))
+                {
+                    size_t end = text.find('\n', pos);
+                    pos = end == std::string_view::npos ? text.size() : end;
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        game.board.chess960 = game.header("Variant").find("960") != std::string_view::npos;
+        std::string_view fen = game.header("FEN");
+        try
+        {
+            if (fen.empty())
+            {
+                game.board.reset();
+            }
+            else
+            {
+                game.board.set_fen(std::string(fen));
+            }
+        }
+        catch (const std::invalid_argument &error)
+        {
+            game.board.reset();
+            game.error = error.what();
+        }
+
+        // Movetext, up to the termination marker or the tag pairs of the next game.
+        int depth = 0;
+        bool line_start = false;
+        while (pos < text.size())
+        {
+            char c = text[pos];
+            if (_is_space(c))
+            {
+                line_start |= c == '\n';
+                ++pos;
+                continue;
+            }
+            bool at_line_start = line_start;
+            line_start = false;
+
+            if (c == '{' || c == ';')
+            {
+                size_t end = text.find(c == '{' ? '}' : '\n', pos + 1);
+                end = end == std::string_view::npos ? text.size() : end;
+                if (!depth)
+                {
+                    game.comments.emplace_back(game.moves.size(), text.substr(pos + 1, end - pos - 1));
+                }
+                pos = std::min(end + 1, text.size());
+            }
+            else if (c == '%' && at_line_start)
+            {
+                size_t end = text.find('\n', pos);
+                pos = end == std::string_view::npos ? text.size() : end;
+            }
+            else if (c == '(')
+            {
+                ++depth;
+                ++game.variations;
+                ++pos;
+            }
+            else if (c == ')')
+            {
+                depth -= depth > 0;
+                ++pos;
+            }
+            else if (c == '[' && at_line_start && !depth)
+            {
+                break;
+            }
+            else if (c == '$')
+            {
+                int nag = 0;
+                while (++pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+                {
+                    nag = nag * 10 + text[pos] - '0';
+                }
+                if (!depth)
+                {
+                    game.nags.emplace_back(game.moves.size(), nag);
+                }
+            }
+            else if (_is_delimiter(c))
+            {
+                // A stray ']' or '[' inside the movetext.
+                ++pos;
+            }
+            else
+            {
+                size_t end = pos;
+                while (end < text.size() && !_is_delimiter(text[end]))
+                {
+                    ++end;
+                }
+                std::string_view token = text.substr(pos, end - pos);
+                pos = end;
+                if (_is_result(token))
+                {
+                    if (!depth)
+                    {
+                        game.result = token;
+                        break;
+                    }
+                    continue;
+                }
+
+                // Move numbers, possibly without a space before the move.
+                size_t digits = token.find_first_not_of("0123456789");
+                if (digits != 0 && digits != std::string_view::npos && token[digits] == '.')
+                {
+                    token.remove_prefix(token.find_first_not_of('.', digits) == std::string_view::npos ? token.size() : token.find_first_not_of('.', digits));
+                }
+                size_t suffix = token.find_last_not_of("!?");
+                if (token.empty() || suffix == std::string_view::npos || digits == std::string_view::npos)
+                {
+                    continue;
+                }
+                int nag = _suffix_nag(token.substr(suffix + 1));
+                token = token.substr(0, suffix + 1);
+                if (!depth && game.error.empty() && game.moves.size() < this->max_plies)
+                {
+                    this->_play(game, token);
+                }
+                if (!depth && nag)
+                {
+                    game.nags.emplace_back(game.moves.size(), nag);
+                }
+            }
+        }
+
+        game.offset = start;
+        game.text = text.substr(start, pos - start);
+        return true;
+    }
+
+    PgnStats read_pgn(std::string_view text, const std::function<bool(const PgnGame &)> &visitor)
+    {
+        /*
+        Reads all games of *text* and calls *visitor* with each. Stops early
+        if the visitor returns ``false``.
+        */
+        auto ts = std::chrono::steady_clock::now();
+        PgnStats stats;
+        PgnReader reader(text);
+        PgnGame game;
+        while (reader.next(game))
+        {
+            ++stats.games;
+            stats.errors += !game.error.empty();
+            stats.moves += game.moves.size();
+            if (!visitor(game))
+            {
+                break;
+            }
+        }
+        stats.bytes = reader.offset();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+        return stats;
+    }
+
+    PgnStats read_pgn_file(const std::string &path, const std::function<bool(const PgnGame &)> &visitor)
+    {
+        /*
+        Maps the PGN file at *path* and reads all its games like
+        :func:`read_pgn()`.
+
+        :throws: :exc:`std::runtime_error` if the file cannot be mapped.
+        */
+        MappedFile file(path, true);
+        return read_pgn(file.view(), visitor);
+    }
+
+    size_t next_game_start(std::string_view text, size_t from)
+    {
+        /*
+        The position of the first game that starts at or after *from*: a
+        tag pair at the start of a line that does not follow another tag
+        pair. Returns the size of *text* if there is none.
+
+        Used to split PGN text into parts that can be read independently.
+        A line inside a comment that looks like the first tag of a game is
+        mistaken for one.
+        */
+        for (size_t pos = from; pos < text.size(); ++pos)
+        {
+            pos = text.find('[', pos);
+            if (pos == std::string_view::npos)
+            {
+                break;
+            }
+            if (pos && text[pos - 1] != '\n')
+            {
+                continue;
+            }
+            if (pos + 1 >= text.size() || !std::isalpha((unsigned char)text[pos + 1]))
+            {
+                continue;
+            }
+
+            // The last non-blank character before the line ends a tag pair
+            // if this is not the first tag of the game.
+            size_t before = text.find_last_not_of(" \t\r\n", pos ? pos - 1 : 0);
+            if (!pos || before == std::string_view::npos || text[before] != ']')
+            {
+                return pos;
+            }
+        }
+        return text.size();
+    }
+
+    class _PgnChunk
+    {
+        // The games of one part of the text, read by a worker.
+
+    public:
+        std::vector<PgnGame> games;
+
+        PgnStats stats;
+    };
+
+    PgnStats read_pgn_parallel(std::string_view text, const std::function<bool(const PgnGame &)> &visitor, const PgnPipelineOptions &options)
+    {
+        /*
+        Reads all games of *text* like :func:`read_pgn()`, but splits the
+        text into chunks at game boundaries (see :func:`next_game_start()`)
+        and reads and replays the chunks on worker threads, each with its
+        own boards.
+
+        *visitor* is called on the calling thread, one game at a time, so it
+        needs no locking. Its games are moved out of the workers with the
+        final position but without its move stack; :data:`PgnGame::moves`
+        has the moves.
+
+        Workers do not start a chunk more than
+        :data:`~PgnPipelineOptions::queue_size` chunks ahead of the visitor,
+        which bounds the memory of a slow visitor.
+
+        An exception thrown by a worker or by *visitor* stops the reading
+        and is rethrown once all workers have finished.
+        */
+        auto ts = std::chrono::steady_clock::now();
+        size_t threads = worker_threads(options.threads);
+        size_t queue_size = options.queue_size ? options.queue_size : 2 * threads;
+        size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+
+        std::mutex mutex;
+        std::condition_variable work_done, chunk_done;
+        size_t next_pos = text.substr(0, 3) == "\xEF\xBB\xBF" ? 3 : 0;
+        size_t next_chunk = 0;
+        size_t delivered = 0;
+        // The number of chunks is known once the last one is taken.
+        size_t chunks = next_pos >= text.size() ? 0 : SIZE_MAX;
+        bool stopped = false;
+        std::exception_ptr error;
+        std::map<size_t, _PgnChunk> results;
+
+        auto read_chunks = [&]
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                work_done.wait(lock, [&]
+                               { return stopped || next_pos >= text.size() || next_chunk - delivered < queue_size; });
+                if (stopped || next_pos >= text.size())
+                {
+                    return;
+                }
+                size_t index = next_chunk++;
+                size_t start = next_pos;
+                size_t end = next_game_start(text, std::min(start + chunk_size, text.size()));
+                next_pos = end;
+                if (next_pos >= text.size())
+                {
+                    chunks = next_chunk;
+                    chunk_done.notify_all();
+                }
+                lock.unlock();
+
+                _PgnChunk chunk;
+                PgnReader reader(text.substr(start, end - start));
+                PgnGame game;
+                while (reader.next(game))
+                {
+                    ++chunk.stats.games;
+                    chunk.stats.errors += !game.error.empty();
+                    chunk.stats.moves += game.moves.size();
+                    game.offset += start;
+                    // Copied, so the game keeps the capacity of its
+                    // containers, but without the move stack.
+                    game.board.clear_stack();
+                    chunk.games.push_back(game);
+                }
+                chunk.stats.bytes = end - start;
+
+                lock.lock();
+                results.emplace(index, std::move(chunk));
+                chunk_done.notify_all();
+            }
+        };
+
+        auto work = [&]
+        {
+            try
+            {
+                read_chunks();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                stopped = true;
+                work_done.notify_all();
+                chunk_done.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(work);
+        }
+
+        PgnStats stats;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopped && delivered < chunks)
+        {
+            chunk_done.wait(lock, [&]
+                            { return stopped || delivered >= chunks || (options.ordered ? results.count(delivered) : !results.empty()); });
+            if (stopped || delivered >= chunks)
+            {
+                break;
+            }
+            auto it = options.ordered ? results.find(delivered) : results.begin();
+            _PgnChunk chunk = std::move(it->second);
+            results.erase(it);
+            lock.unlock();
+
+            stats.add(chunk.stats);
+            bool more = true;
+            std::exception_ptr visitor_error;
+            try
+            {
+                for (size_t i = 0; i < chunk.games.size() && more; ++i)
+                {
+                    more = visitor(chunk.games[i]);
+                }
+            }
+            catch (...)
+            {
+                visitor_error = std::current_exception();
+                more = false;
+            }
+
+            lock.lock();
+            if (visitor_error && !error)
+            {
+                error = visitor_error;
+            }
+            stopped |= !more;
+            ++delivered;
+            work_done.notify_all();
+        }
+        stopped = true;
+        work_done.notify_all();
+        lock.unlock();
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+        return stats;
+    }
+
+    PgnStats read_pgn_file_parallel(const std::string &path, const std::function<bool(const PgnGame &)> &visitor, const PgnPipelineOptions &options)
+    {
+        /*
+        Maps the PGN file at *path* and reads all its games like
+        :func:`read_pgn_parallel()`.
+
+        :throws: :exc:`std::runtime_error` if the file cannot be mapped.
+        */
+        MappedFile file(path, true);
+        return read_pgn_parallel(file.view(), visitor, options);
+    }
@@ -0,0 +1,135 @@
+#ifndef PGN_H_INCLUDED
+#define PGN_H_INCLUDED
+#include "Board.h"
+#include "mmap.h"
+#include <functional>
+#include <string_view>
+
+    class PgnGame
+    {
+        /*
+        A game read by a :class:`PgnReader`. All views point into the text
+        the reader was created with and are only valid as long as it is.
+        */
+
+    public:
+        std::vector<std::pair<std::string_view, std::string_view>> headers;
+        /* Tag pairs in file order. Values are raw: escaped quotes and backslashes are not unescaped. */
+
+        std::vector<Move> moves;
+        /* The mainline. */
+
+        std::vector<std::pair<size_t, std::string_view>> comments;
+        /* Mainline comments with the number of moves played before them. */
+
+        std::vector<std::pair<size_t, int>> nags;
+        /* Mainline NAGs, including ``!`` and ``?`` suffixes, with the number of moves played before them. */
+
+        size_t variations = 0;
+        /* The number of variations. They are tokenized but not replayed. */
+
+        std::string_view result;
+        /* The game termination marker, empty if the game has none. */
+
+        std::string_view text;
+        /* The text of the whole game. */
+
+        size_t offset = 0;
+        /* The position of :data:`text` in the text of the reader. */
+
+        Board board;
+        /* The position at the end of the mainline, or before the first illegal move. */
+
+        std::string error;
+        /* Why the mainline could not be replayed to the end, empty if it could. */
+
+        std::string_view header(std::string_view, std::string_view = "") const;
+
+        void clear();
+    };
+
+    class PgnStats
+    {
+        /* Counters of a :func:`read_pgn()` call. */
+
+    public:
+        uint64_t games = 0;
+
+        uint64_t errors = 0;
+        /* Games with an illegal move or an invalid FEN tag. */
+
+        uint64_t moves = 0;
+
+        uint64_t bytes = 0;
+
+        double seconds = 0;
+
+        double games_per_second() const;
+
+        double mb_per_second() const;
+
+        void add(const PgnStats &);
+    };
+
+    class PgnReader
+    {
+        /*
+        Reads games from PGN text without copying it: headers, comments and
+        the game text are views into the text.
+
+        The mainline is replayed on :data:`PgnGame::board` with
+        :func:`resolve_san()`. Reading goes on after errors: a game with an
+        illegal move is skipped to its end and has its
+        :data:`~PgnGame::error` set.
+        */
+
+    public:
+        size_t max_plies = SIZE_MAX;
+        /* Mainline moves to replay; the rest of a game is still read up to its termination marker. */
+
+        PgnReader(std::string_view);
+
+        bool next(PgnGame &);
+
+        size_t offset() const;
+
+    private:
+        std::string_view _text;
+
+        size_t _pos = 0;
+
+        bool _read_header(PgnGame &);
+
+        void _play(PgnGame &, std::string_view);
+    };
+
+    class PgnPipelineOptions
+    {
+        /* How :func:`read_pgn_parallel()` splits and distributes the work. */
+
+    public:
+        size_t threads = 0;
+        /* Worker threads; 0 for one per hardware thread. */
+
+        size_t chunk_size = 1 << 20;
+        /* Bytes per chunk, rounded up to the next game. */
+
+        size_t queue_size = 0;
+        /* Chunks read or being read ahead of the visitor; 0 for twice the number of threads. */
+
+        bool ordered = true;
+        /* Deliver games in file order, otherwise in the order chunks finish. */
+    };
+
+    Move resolve_san(Board &, std::string_view);
+
+    size_t next_game_start(std::string_view, size_t);
+
+    PgnStats read_pgn(std::string_view, const std::function<bool(const PgnGame &)> &);
+
+    PgnStats read_pgn_file(const std::string &, const std::function<bool(const PgnGame &)> &);
+
+    PgnStats read_pgn_parallel(std::string_view, const std::function<bool(const PgnGame &)> &, const PgnPipelineOptions & = PgnPipelineOptions());
+
+    PgnStats read_pgn_file_parallel(const std::string &, const std::function<bool(const PgnGame &)> &, const PgnPipelineOptions & = PgnPipelineOptions());
+#endif // PGN_H_INCLUDED
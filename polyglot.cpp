@@ -0,0 +1,290 @@
+#include "polyglot.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+    static uint64_t _get_be(const uint8_t *data, int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value = value << 8 | data[i];
+        }
+        return value;
+    }
+
+    static void _put_be(uint8_t *data, uint64_t value, int bytes)
+    {
+        for (int i = bytes - 1; i >= 0; --i)
+        {
+            data[i] = uint8_t(value);
+            value >>= 8;
+        }
+    }
+
+    PolyglotBook::PolyglotBook(const std::string &path)
+    {
+        this->open(path);
+    }
+
+    void PolyglotBook::open(const std::string &path)
+    {
+        /*
+        Maps the book at *path*, closing the previous one.
+
+        :throws: :exc:`std::runtime_error` if the file cannot be opened or
+            its size is not a multiple of :data:`POLYGLOT_ENTRY_SIZE`.
+        */
+        this->close();
+        this->_file.open(path);
+        if (this->_file.size() % POLYGLOT_ENTRY_SIZE)
+        {
+            this->_file.close();
+            throw std::runtime_error("not a Polyglot book: " + path);
+        }
+        this->_data = (const uint8_t *)this->_file.data();
+        this->_size = this->_file.size() / POLYGLOT_ENTRY_SIZE;
+    }
+
+    void PolyglotBook::close()
+    {
+        this->_file.close();
+        this->_data = nullptr;
+        this->_size = 0;
+    }
+
+    bool PolyglotBook::is_open() const
+    {
+        return this->_file.is_open();
+    }
+
+    size_t PolyglotBook::size() const
+    {
+        /* The number of entries. */
+        return this->_size;
+    }
+
+    PolyglotEntry PolyglotBook::entry(size_t index) const
+    {
+        /* The entry at *index*, without :data:`~PolyglotEntry::move`. */
+        const uint8_t *data = this->_data + index * POLYGLOT_ENTRY_SIZE;
+        PolyglotEntry entry;
+        entry.key = _get_be(data, 8);
+        entry.raw_move = _get_be(data + 8, 2);
+        entry.weight = _get_be(data + 10, 2);
+        entry.learn = _get_be(data + 12, 4);
+        return entry;
+    }
+
+    size_t PolyglotBook::lower_bound(Bitboard key) const
+    {
+        /* The index of the first entry with a key not less than *key*. */
+        size_t low = 0, high = this->_size;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            if (_get_be(this->_data + middle * POLYGLOT_ENTRY_SIZE, 8) < key)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    bool PolyglotBook::_probe(const Board &board, size_t index, int minimum_weight, PolyglotEntry &entry) const
+    {
+        // Reads the entry at *index* into *entry*, and checks that it has
+        // enough weight and a legal move in *board*.
+        entry = this->entry(index);
+        if (entry.weight < minimum_weight)
+        {
+            return false;
+        }
+        entry.move = from_polyglot_move(board, entry.raw_move);
+        return board.is_legal(entry.move);
+    }
+
+    size_t PolyglotBook::find_all(const Board &board, PolyglotEntry *entries, size_t max_entries, int minimum_weight) const
+    {
+        /*
+        Writes up to *max_entries* entries for the position of *board* to
+        *entries*, in book order. Entries with less than *minimum_weight*
+        or an illegal move are skipped.
+
+        Returns the number of entries written.
+        */
+        Bitboard key = board.polyglot_key();
+        size_t count = 0;
+        for (size_t index = this->lower_bound(key); index < this->_size && count < max_entries; ++index)
+        {
+            if (_get_be(this->_data + index * POLYGLOT_ENTRY_SIZE, 8) != key)
+            {
+                break;
+            }
+            if (this->_probe(board, index, minimum_weight, entries[count]))
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    std::optional<PolyglotEntry> PolyglotBook::find(const Board &board, int minimum_weight) const
+    {
+        /*
+        Gets the entry with the highest weight for the position of *board*,
+        the first one among equals, or ``std::nullopt`` if there is none.
+        */
+        Bitboard key = board.polyglot_key();
+        std::optional<PolyglotEntry> best;
+        PolyglotEntry entry;
+        for (size_t index = this->lower_bound(key); index < this->_size; ++index)
+        {
+            if (_get_be(this->_data + index * POLYGLOT_ENTRY_SIZE, 8) != key)
+            {
+                break;
+            }
+            if (this->_probe(board, index, minimum_weight, entry) && (!best || entry.weight > best->weight))
+            {
+                best = entry;
+            }
+        }
+        return best;
+    }
+
+    std::optional<PolyglotEntry> PolyglotBook::choice(const Board &board, uint64_t random, int minimum_weight) const
+    {
+        /*
+        Picks an entry for the position of *board* with a probability
+        proportional to its weight, using the caller's *random* number so
+        that concurrent games need no shared generator. Returns
+        ``std::nullopt`` if there is no entry.
+        */
+        Bitboard key = board.polyglot_key();
+        size_t first = this->lower_bound(key);
+        uint64_t total = 0;
+        PolyglotEntry entry;
+        size_t index = first;
+        for (; index < this->_size && _get_be(this->_data + index * POLYGLOT_ENTRY_SIZE, 8) == key; ++index)
+        {
+            if (this->_probe(board, index, minimum_weight, entry))
+            {
+                total += entry.weight;
+            }
+        }
+        if (!total)
+        {
+            return std::nullopt;
+        }
+
+        uint64_t target = random % total;
+        for (size_t i = first; i < index; ++i)
+        {
+            if (this->_probe(board, i, minimum_weight, entry))
+            {
+                if (target < entry.weight)
+                {
+                    return entry;
+                }
+                target -= entry.weight;
+            }
+        }
+        return std::nullopt;
+    }
+
+    PolyglotBuildStats build_polyglot_book(const std::string &pgn_path, const std::string &book_path, const PolyglotBuildOptions &options)
+    {
+        /*
+        Builds a Polyglot book at *book_path* from the games of the PGN file
+        at *pgn_path*, counted by :func:`count_pgn_moves()`. Entries are
+        sorted by key and by weight within a position.
+
+        The weight of a move is ``2 * wins + draws``, scaled down for
+        positions where it would not fit in 16 bits.
+
+        :throws: :exc:`std::runtime_error` if a file cannot be opened or
+            written.
+        */
+        std::ofstream out(book_path, std::ios::binary);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + book_path);
+        }
+        PolyglotBuildStats stats;
+        std::vector<std::pair<uint64_t, uint16_t>> weights;
+        std::vector<uint8_t> data;
+        // The lambda counts the entries, the rest of the counters come from counting.
+        static_cast<MoveCountStats &>(stats) = count_pgn_moves(pgn_path, [&](const MoveCount *counts, size_t size)
+                                      {
+                                          weights.clear();
+                                          uint64_t max_weight = 0;
+                                          for (size_t i = 0; i < size; ++i)
+                                          {
+                                              if (counts[i].games >= options.min_games)
+                                              {
+                                                  weights.emplace_back(2 * uint64_t(counts[i].wins) + counts[i].draws, counts[i].move);
+                                                  max_weight = std::max(max_weight, weights.back().first);
+                                              }
+                                          }
+                                          std::stable_sort(weights.begin(), weights.end(), [](const auto &a, const auto &b)
+                                                           { return a.first > b.first; });
+                                          data.resize(weights.size() * POLYGLOT_ENTRY_SIZE);
+                                          for (size_t i = 0; i < weights.size(); ++i)
+                                          {
+                                              PolyglotEntry entry;
+                                              entry.key = counts[0].key;
+                                              entry.raw_move = weights[i].second;
+                                              entry.weight = max_weight > 0xFFFF ? weights[i].first * 0xFFFF / max_weight : weights[i].first;
+                                              write_polyglot_entry(data.data() + i * POLYGLOT_ENTRY_SIZE, entry);
+                                          }
+                                          out.write((const char *)data.data(), data.size());
+                                          stats.entries += weights.size();
+                                      },
+                                      options);
+        out.close();
+        if (!out)
+        {
+            throw std::runtime_error("cannot write " + book_path);
+        }
+        return stats;
+    }
+
+    uint16_t polyglot_move(const Board &board, const Move &move)
+    {
+        /*
+        Encodes a legal *move* of *board* as a Polyglot book move: like
+        :func:`encode_raw_move()`, with castling as the king capturing its
+        rook.
+        */
+        int raw_move = board.encode_move(move);
+        return (raw_move >> 12) > 4 ? raw_move & 0xFFF : raw_move;
+    }
+
+    Move from_polyglot_move(const Board &board, uint16_t raw_move)
+    {
+        /*
+        Decodes a Polyglot book move in *board*, translating the king
+        capturing its own rook to castling in the notation of the board.
+        Does not check legality.
+        */
+        Square from_square = (raw_move >> 6) & 0x3F, to_square = raw_move & 0x3F;
+        if (!(raw_move >> 12) && board.kings & BB_SQUARES[from_square] &&
+            board.rooks & board.occupied_co[board.turn] & BB_SQUARES[to_square])
+        {
+            return board.decode_move(raw_move | RAW_MOVE_CASTLING);
+        }
+        return decode_raw_move(raw_move & 0x7FFF);
+    }
+
+    void write_polyglot_entry(uint8_t *data, const PolyglotEntry &entry)
+    {
+        /* Writes *entry* as :data:`POLYGLOT_ENTRY_SIZE` bytes at *data*. */
+        _put_be(data, entry.key, 8);
+        _put_be(data + 8, entry.raw_move, 2);
+        _put_be(data + 10, entry.weight, 2);
+        _put_be(data + 12, entry.learn, 4);
+    }
@@ -0,0 +1,98 @@
+#ifndef POLYGLOT_H_INCLUDED
+#define POLYGLOT_H_INCLUDED
+#include "movecount.h"
+
+    const size_t POLYGLOT_ENTRY_SIZE = 16;
+    /* The size of an entry of a Polyglot book. */
+
+    class PolyglotEntry
+    {
+        /*
+        An entry of a Polyglot book: a move played in the position with
+        the :func:`~Board::polyglot_key()` *key*.
+        */
+
+    public:
+        Bitboard key = 0;
+
+        uint16_t raw_move = 0;
+        /* The move as stored in the book, see :func:`polyglot_move()`. */
+
+        uint16_t weight = 0;
+
+        uint32_t learn = 0;
+
+        Move move = Move::null();
+        /* :data:`raw_move` in the castling notation of the probed board. */
+    };
+
+    class PolyglotBook
+    {
+        /*
+        An opening book in the Polyglot format, mapped read-only into
+        memory: entries of 16 big-endian bytes sorted by key.
+
+        Lookups binary search the mapping and write into buffers of the
+        caller, so they do not allocate, and are safe to run concurrently
+        from any number of threads on the same book.
+        */
+
+    public:
+        PolyglotBook() = default;
+
+        PolyglotBook(const std::string &);
+
+        void open(const std::string &);
+
+        void close();
+
+        bool is_open() const;
+
+        size_t size() const;
+
+        PolyglotEntry entry(size_t) const;
+
+        size_t lower_bound(Bitboard) const;
+
+        size_t find_all(const Board &, PolyglotEntry *, size_t, int = 1) const;
+
+        std::optional<PolyglotEntry> find(const Board &, int = 1) const;
+
+        std::optional<PolyglotEntry> choice(const Board &, uint64_t, int = 1) const;
+
+    private:
+        MappedFile _file;
+
+        const uint8_t *_data = nullptr;
+
+        size_t _size = 0;
+
+        bool _probe(const Board &, size_t, int, PolyglotEntry &) const;
+    };
+
+    class PolyglotBuildOptions : public MoveCountOptions
+    {
+        /* How :func:`build_polyglot_book()` builds a book. */
+
+    public:
+        uint32_t min_games = 1;
+        /* Moves played in fewer games are left out. */
+    };
+
+    class PolyglotBuildStats : public MoveCountStats
+    {
+        /* Counters of a :func:`build_polyglot_book()` call. */
+
+    public:
+        uint64_t entries = 0;
+        /* Entries written to the book. */
+    };
+
+    PolyglotBuildStats build_polyglot_book(const std::string &, const std::string &, const PolyglotBuildOptions & = PolyglotBuildOptions());
+
+    uint16_t polyglot_move(const Board &, const Move &);
+
+    Move from_polyglot_move(const Board &, uint16_t);
+
+    void write_polyglot_entry(uint8_t *, const PolyglotEntry &);
+#endif // POLYGLOT_H_INCLUDED
@@ -0,0 +1,585 @@
+#include "search.h"
+
+    double SearchStats::first_move_cutoff_rate() const
+    {
+        /*
+        The share of beta cutoffs that were produced by the first move
+        searched. A measure of move ordering quality; well ordered searches
+        reach 0.9 and more.
+        */
+        return this->fail_highs ? double(this->fail_highs_first) / this->fail_highs : 0.0;
+    }
+
+    void SearchStats::clear()
+    {
+        this->nodes = 0;
+        this->qnodes = 0;
+        this->fail_highs = 0;
+        this->fail_highs_first = 0;
+    }
+
+    Move pick_move(std::vector<Move> &moves, std::vector<int> &scores, size_t i)
+    {
+        /*
+        Moves the best scored move among ``moves[i:]`` to index *i* and
+        returns it. Only as much of the list is sorted as is searched.
+        */
+        size_t best = i;
+        for (size_t j = i + 1; j < moves.size(); ++j)
+        {
+            if (scores[j] > scores[best])
+            {
+                best = j;
+            }
+        }
+        std::swap(moves[i], moves[best]);
+        std::swap(scores[i], scores[best]);
+        return moves[i];
+    }
+
+    std::vector<std::vector<int>> _lmr_reductions()
+    {
+        // Reductions grow with the logarithms of both the remaining depth and
+        // the position of the move in the ordering.
+        std::vector<std::vector<int>> reductions(64, std::vector<int>(64, 0));
+        for (int depth = 1; depth < 64; ++depth)
+        {
+            for (int move_count = 1; move_count < 64; ++move_count)
+            {
+                reductions[depth][move_count] = int(0.75 + std::log(depth) * std::log(move_count) / 2.25);
+            }
+        }
+        return reductions;
+    }
+
+    const std::vector<std::vector<int>> LMR_REDUCTIONS = _lmr_reductions();
+
+    Search::Search(const Board &board) : board(board)
+    {
+        this->clear();
+    }
+
+    void Search::clear()
+    {
+        /* Forgets all move ordering statistics, e.g., for a new game. */
+        this->main_history.clear();
+        this->continuation_history.clear();
+        this->killers.clear();
+        this->counter_moves.clear();
+        this->stats.clear();
+        this->pv.clear();
+        this->pvs.clear();
+        this->pv_values.clear();
+        this->completed_depth = 0;
+    }
+
+    Value Search::evaluate()
+    {
+        /*
+        Static evaluation from the point of view of the side to move, kept
+        clear of the mate score range. Uses the network if one is loaded and
+        :data:`Network::enabled`.
+        */
+        Value value = Network::enabled && network().loaded() ? thread_nnue().evaluate(this->board) : eval(this->board);
+        value = std::clamp(value, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
+        return this->board.turn == WHITE ? value : -value;
+    }
+
+    Value Search::iterate(int depth, const std::function<void(int, Value)> &on_iteration)
+    {
+        /*
+        Searches the root position with iterative deepening up to *depth*
+        plies. *on_iteration* is called after every completed iteration with
+        its depth and the score of the best line.
+
+        Every iteration searches :data:`~SearchOptions::multipv` lines, each
+        excluding the first moves of the lines before it.
+
+        Returns the score of the last iteration. The best lines are in
+        :data:`~Search::pvs`.
+        */
+        this->stats.clear();
+        this->pv.clear();
+        this->pvs.clear();
+        this->pv_values.clear();
+        this->completed_depth = 0;
+        this->nodes_searched = 0;
+        for (int i = 0; i < 2; ++i)
+        {
+            this->_frames[i].piece = -1;
+            this->_frames[i].continuation = nullptr;
+        }
+
+        size_t multipv = std::max(this->options.multipv, 1);
+        Value value = VALUE_NONE;
+        for (int d = 1; d <= depth && !this->stop; ++d)
+        {
+            if (this->_skip_depth(d) && d < depth)
+            {
+                continue;
+            }
+
+            std::vector<std::vector<Move>> pvs;
+            std::vector<Value> pv_values;
+            this->_excluded.clear();
+            for (this->_pv_index = 0; this->_pv_index < multipv; ++this->_pv_index)
+            {
+                Value line_value = this->search(-VALUE_INFINITE, VALUE_INFINITE, d, 0);
+                if ((this->stop && (!this->pv.empty() || !pvs.empty())) || line_value == -VALUE_INFINITE)
+                {
+                    // Aborted, or no root moves left to search.
+                    break;
+                }
+
+                std::vector<Move> line;
+                for (int i = 0; i < this->_pv_length[0]; ++i)
+                {
+                    line.push_back(decode_raw_move(this->_pv[0][i]));
+                }
+                pvs.push_back(line);
+                pv_values.push_back(line_value);
+                if (line.empty() || this->stop)
+                {
+                    break;
+                }
+                this->_excluded.push_back(line.front());
+            }
+
+            // An aborted iteration is discarded, unless there is nothing
+            // better to fall back on.
+            if (this->stop && !this->pv.empty())
+            {
+                break;
+            }
+
+            this->pvs = pvs;
+            this->pv_values = pv_values;
+            this->pv = pvs.empty() ? std::vector<Move>() : pvs.front();
+            value = pv_values.empty() ? VALUE_NONE : pv_values.front();
+            this->completed_depth = d;
+            this->nodes_searched.store(this->stats.nodes, std::memory_order_relaxed);
+
+            if (on_iteration && !this->stop)
+            {
+                on_iteration(d, value);
+            }
+
+            // Stop when a mate within the requested distance was found.
+            if (this->limits.mate && std::abs(value) >= VALUE_MATE_IN_MAX_PLY && VALUE_MATE - std::abs(value) <= 2 * this->limits.mate)
+            {
+                break;
+            }
+
+            // Do not start an iteration that is unlikely to finish in time.
+            if (this->time.enabled && !this->pondering && !this->limits.infinite && this->time.elapsed() >= this->time.soft_limit)
+            {
+                break;
+            }
+        }
+        this->nodes_searched.store(this->stats.nodes, std::memory_order_relaxed);
+        return value;
+    }
+
+    Value Search::search(Value alpha, Value beta, int depth, int ply)
+    {
+        /*
+        Fail-soft principal variation search of the current position to
+        *depth* plies, *ply* plies from the root.
+        */
+        if (depth <= 0)
+        {
+            return this->qsearch(alpha, beta, ply);
+        }
+
+        this->_pv_length[ply] = ply;
+        if (++this->stats.nodes % TIME_CHECK_INTERVAL == 0)
+        {
+            this->_check_limits();
+        }
+        if (this->stop)
+        {
+            return VALUE_ZERO;
+        }
+
+        if (ply && (this->board.is_fifty_moves() || this->board.is_insufficient_material() || this->board.is_repetition(2)))
+        {
+            return VALUE_DRAW;
+        }
+
+        if (ply >= MAX_PLY - 1)
+        {
+            return this->evaluate();
+        }
+
+        std::vector<Move> moves = this->board.generate_legal_moves();
+        bool in_check = this->board.is_check();
+        if (moves.empty())
+        {
+            return in_check ? -VALUE_MATE + ply : VALUE_DRAW;
+        }
+
+        if (ply == 0)
+        {
+            std::erase_if(moves, [this](const Move &move)
+                          { return std::find(this->_excluded.begin(), this->_excluded.end(), move) != this->_excluded.end() ||
+                                   (!this->limits.searchmoves.empty() &&
+                                    std::find(this->limits.searchmoves.begin(), this->limits.searchmoves.end(), move) == this->limits.searchmoves.end()); });
+            if (moves.empty())
+            {
+                return -VALUE_INFINITE;
+            }
+        }
+
+        if (ply + 2 < KILLER_PLIES)
+        {
+            this->killers.clear_ply(ply + 2);
+        }
+
+        Color us = this->board.turn;
+        Frame *frame = this->_frame(ply);
+        bool pv_node = beta - alpha > 1;
+        Value static_eval = in_check ? VALUE_NONE : this->evaluate();
+
+        // Reverse futility pruning: the static evaluation is so far above
+        // beta that a shallow search will not bring it down.
+        if (this->options.reverse_futility && !pv_node && !in_check && depth <= 6 &&
+            static_eval - 120 * depth >= beta && beta > VALUE_TB_LOSS_IN_MAX_PLY && beta < VALUE_TB_WIN_IN_MAX_PLY)
+        {
+            return static_eval;
+        }
+
+        // Null move pruning: if passing still fails high, a real move will,
+        // too. Not after another null move and not without pieces, where
+        // zugzwang is common.
+        if (this->options.null_move && !pv_node && !in_check && ply && depth >= 3 && static_eval >= beta &&
+            this->_frame(ply - 1)->piece != -1 && this->board.occupied_co[us] & ~this->board.pawns & ~this->board.kings)
+        {
+            int reduction = 3 + depth / 6;
+            frame->piece = -1;
+            frame->continuation = nullptr;
+
+            this->board.push(Move::null());
+            Value value = -this->search(-beta, -beta + 1, depth - 1 - reduction, ply + 1);
+            this->board.pop();
+
+            if (this->stop)
+            {
+                return VALUE_ZERO;
+            }
+            if (value >= beta)
+            {
+                return value >= VALUE_TB_WIN_IN_MAX_PLY ? beta : value;
+            }
+        }
+
+        std::vector<int> scores;
+        this->_score_moves(moves, scores, ply, ply == 0 && this->_pv_index < this->pvs.size() && !this->pvs[this->_pv_index].empty() ? encode_raw_move(this->pvs[this->_pv_index].front()) : 0);
+
+        std::vector<Move> quiets_tried;
+        Value best_value = -VALUE_INFINITE;
+        int move_count = 0;
+
+        for (size_t i = 0; i < moves.size(); ++i)
+        {
+            Move move = pick_move(moves, scores, i);
+            bool quiet = !this->board.is_capture(move) && !move.promotion;
+            bool gives_check = (this->options.check_extensions || this->options.futility || this->options.late_move_reductions) && this->board.gives_check(move);
+
+            // Futility pruning: a quiet move is unlikely to make up for a
+            // static evaluation far below alpha at low depth.
+            if (this->options.futility && !pv_node && !in_check && quiet && !gives_check && depth <= 3 &&
+                best_value > VALUE_TB_LOSS_IN_MAX_PLY && static_eval + 150 + 100 * depth <= alpha)
+            {
+                continue;
+            }
+
+            ++move_count;
+            int new_depth = depth - 1 + (this->options.check_extensions && gives_check ? 1 : 0);
+
+            frame->piece = piece_index(*this->board.piece_type_at(move.from_square), us);
+            frame->to_square = move.to_square;
+            frame->continuation = &this->continuation_history.at(frame->piece, move.to_square);
+
+            this->board.push(move);
+            Value value;
+            if (move_count == 1)
+            {
+                value = -this->search(-beta, -alpha, new_depth, ply + 1);
+            }
+            else
+            {
+                // Late move reductions: quiet moves late in the ordering are
+                // searched shallower with a null window first.
+                int reduction = 0;
+                if (this->options.late_move_reductions && depth >= 3 && move_count > 3 && quiet && !in_check && !gives_check)
+                {
+                    reduction = LMR_REDUCTIONS[std::min(depth, 63)][std::min(move_count, 63)] - pv_node;
+                    reduction = std::clamp(reduction, 0, new_depth - 1);
+                }
+
+                value = -this->search(-alpha - 1, -alpha, new_depth - reduction, ply + 1);
+                if (value > alpha && reduction)
+                {
+                    value = -this->search(-alpha - 1, -alpha, new_depth, ply + 1);
+                }
+                if (value > alpha && value < beta)
+                {
+                    value = -this->search(-beta, -alpha, new_depth, ply + 1);
+                }
+            }
+            this->board.pop();
+
+            if (this->stop)
+            {
+                return VALUE_ZERO;
+            }
+
+            if (value > best_value)
+            {
+                best_value = value;
+                if (value > alpha)
+                {
+                    alpha = value;
+                    this->_update_pv(ply, move);
+
+                    if (alpha >= beta)
+                    {
+                        ++this->stats.fail_highs;
+                        if (move_count == 1)
+                        {
+                            ++this->stats.fail_highs_first;
+                        }
+                        if (quiet)
+                        {
+                            this->_update_quiet_stats(move, quiets_tried, depth, ply);
+                        }
+                        break;
+                    }
+                }
+            }
+
+            if (quiet)
+            {
+                quiets_tried.push_back(move);
+            }
+        }
+
+        return best_value;
+    }
+
+    Value Search::qsearch(Value alpha, Value beta, int ply)
+    {
+        /*
+        Quiescence search: resolves captures and promotions that do not lose
+        material by :func:`~Board::see_ge()`, or all evasions when in check.
+        */
+        this->_pv_length[ply] = ply;
+        ++this->stats.qnodes;
+        if (++this->stats.nodes % TIME_CHECK_INTERVAL == 0)
+        {
+            this->_check_limits();
+        }
+        if (this->stop)
+        {
+            return VALUE_ZERO;
+        }
+
+        if (ply >= MAX_PLY - 1)
+        {
+            return this->evaluate();
+        }
+
+        bool in_check = this->board.is_check();
+        Value best_value = -VALUE_INFINITE;
+        if (!in_check)
+        {
+            best_value = this->evaluate();
+            if (best_value >= beta)
+            {
+                return best_value;
+            }
+            alpha = std::max(alpha, best_value);
+        }
+
+        std::vector<Move> moves = this->board.generate_legal_moves();
+        if (in_check && moves.empty())
+        {
+            return -VALUE_MATE + ply;
+        }
+
+        if (!in_check)
+        {
+            std::erase_if(moves, [this](const Move &move)
+                          { return !(this->board.is_capture(move) || move.promotion) || !this->board.see_ge(move); });
+        }
+
+        std::vector<int> scores;
+        this->_score_moves(moves, scores, ply, 0);
+
+        for (size_t i = 0; i < moves.size(); ++i)
+        {
+            Move move = pick_move(moves, scores, i);
+
+            this->_frame(ply)->continuation = nullptr;
+            this->board.push(move);
+            Value value = -this->qsearch(-beta, -alpha, ply + 1);
+            this->board.pop();
+
+            if (this->stop)
+            {
+                return VALUE_ZERO;
+            }
+
+            if (value > best_value)
+            {
+                best_value = value;
+                if (value > alpha)
+                {
+                    alpha = value;
+                    this->_update_pv(ply, move);
+                    if (alpha >= beta)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+        return best_value;
+    }
+
+    void Search::_score_moves(const std::vector<Move> &moves, std::vector<int> &scores, int ply, uint16_t first_move)
+    {
+        // Tactical moves first, by victim and then attacker (MVV-LVA), with
+        // losing captures behind the quiet moves. Then killers, the counter
+        // move and the remaining quiet moves by history.
+        Color us = this->board.turn;
+        const Frame *previous = this->_frame(ply - 1);
+        const Frame *previous2 = this->_frame(ply - 2);
+        uint16_t counter = previous->continuation ? this->counter_moves.at(previous->piece, previous->to_square) : 0;
+        uint16_t killer1 = ply < KILLER_PLIES ? this->killers.table[ply][0] : 0;
+        uint16_t killer2 = ply < KILLER_PLIES ? this->killers.table[ply][1] : 0;
+
+        scores.resize(moves.size());
+        for (size_t i = 0; i < moves.size(); ++i)
+        {
+            const Move &move = moves[i];
+            uint16_t raw = encode_raw_move(move);
+            PieceType piece_type = *this->board.piece_type_at(move.from_square);
+
+            if (raw == first_move)
+            {
+                scores[i] = 4'000'000;
+            }
+            else if (this->board.is_capture(move) || move.promotion)
+            {
+                PieceType victim = this->board.is_en_passant(move) ? PAWN : this->board.piece_type_at(move.to_square).value_or(0);
+                int mvv_lva = PIECE_VALUES[victim] * 8 + PIECE_VALUES[move.promotion.value_or(0)] - piece_type;
+                scores[i] = (this->board.see_ge(move) ? 2'000'000 : -2'000'000) + mvv_lva;
+            }
+            else if (raw == killer1)
+            {
+                scores[i] = 1'000'002;
+            }
+            else if (raw == killer2)
+            {
+                scores[i] = 1'000'001;
+            }
+            else if (raw == counter)
+            {
+                scores[i] = 1'000'000;
+            }
+            else
+            {
+                int piece = piece_index(piece_type, us);
+                scores[i] = this->main_history.get(us, move);
+                if (previous->continuation)
+                {
+                    scores[i] += (*previous->continuation)[piece][move.to_square];
+                }
+                if (previous2->continuation)
+                {
+                    scores[i] += (*previous2->continuation)[piece][move.to_square];
+                }
+            }
+        }
+    }
+
+    void Search::_update_quiet_stats(const Move &move, const std::vector<Move> &quiets_tried, int depth, int ply)
+    {
+        // Reward the quiet move that caused a cutoff and penalize the quiet
+        // moves searched before it.
+        Color us = this->board.turn;
+        const Frame *previous = this->_frame(ply - 1);
+        const Frame *previous2 = this->_frame(ply - 2);
+        int bonus = history_bonus(depth);
+
+        auto update = [&](const Move &m, int b)
+        {
+            int piece = piece_index(*this->board.piece_type_at(m.from_square), us);
+            update_history(this->main_history.at(us, m), b);
+            if (previous->continuation)
+            {
+                update_history((*previous->continuation)[piece][m.to_square], b);
+            }
+            if (previous2->continuation)
+            {
+                update_history((*previous2->continuation)[piece][m.to_square], b);
+            }
+        };
+
+        update(move, bonus);
+        for (const Move &quiet : quiets_tried)
+        {
+            update(quiet, -bonus);
+        }
+
+        uint16_t raw = encode_raw_move(move);
+        if (ply < KILLER_PLIES)
+        {
+            this->killers.update(ply, raw);
+        }
+        if (previous->continuation)
+        {
+            this->counter_moves.at(previous->piece, previous->to_square) = raw;
+        }
+    }
+
+    void Search::_update_pv(int ply, const Move &move)
+    {
+        this->_pv[ply][ply] = encode_raw_move(move);
+        for (int i = ply + 1; i < this->_pv_length[ply + 1]; ++i)
+        {
+            this->_pv[ply][i] = this->_pv[ply + 1][i];
+        }
+        this->_pv_length[ply] = std::max(this->_pv_length[ply + 1], ply + 1);
+    }
+
+    void Search::_check_limits()
+    {
+        // Called every TIME_CHECK_INTERVAL nodes.
+        this->nodes_searched.store(this->stats.nodes, std::memory_order_relaxed);
+        if (this->limits.nodes && this->stats.nodes >= this->limits.nodes)
+        {
+            this->stop = true;
+        }
+        if (this->time.enabled && !this->pondering && !this->limits.infinite && this->time.elapsed() >= this->time.hard_limit)
+        {
+            this->stop = true;
+        }
+    }
+
+    bool Search::_skip_depth(int depth) const
+    {
+        // Helper threads skip blocks of iterations, with the block size and
+        // phase depending on the thread index, so that the threads spread
+        // over several depths.
+        static const int SKIP_SIZE[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+        static const int SKIP_PHASE[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+        if (this->thread_index == 0 || depth == 1)
+        {
+            return false;
+        }
+        int i = (this->thread_index - 1) % 20;
+        return (depth + SKIP_PHASE[i]) / SKIP_SIZE[i] % 2;
+    }
@@ -0,0 +1,179 @@
+#ifndef SEARCH_H_INCLUDED
+#define SEARCH_H_INCLUDED
+#include "eval.h"
+#include "nnue.h"
+#include "history.h"
+#include "timeman.h"
+
+    const uint64_t TIME_CHECK_INTERVAL = 128;
+    /* Number of nodes between two checks of the clock and node limits. */
+
+    class SearchStats
+    {
+        /* Node counters collected during a search. */
+
+    public:
+        uint64_t nodes = 0;
+        /* All visited nodes, including quiescence nodes. */
+
+        uint64_t qnodes = 0;
+        /* Quiescence nodes. */
+
+        uint64_t fail_highs = 0;
+        /* Beta cutoffs in the main search. */
+
+        uint64_t fail_highs_first = 0;
+        /* Beta cutoffs produced by the first move searched. */
+
+        double first_move_cutoff_rate() const;
+
+        void clear();
+    };
+
+    class SearchOptions
+    {
+        /*
+        Switches for the selective parts of :class:`Search`. All enabled by
+        default; disable single techniques to measure their effect.
+        */
+
+    public:
+        bool null_move = true;
+        /* Null move pruning: skip a turn and prune if still above beta. */
+
+        bool late_move_reductions = true;
+        /* Search late quiet moves to reduced depth, re-searching on fail high. */
+
+        bool reverse_futility = true;
+        /* Return the static evaluation if it exceeds beta by a depth margin. */
+
+        bool futility = true;
+        /* Skip quiet moves at low depth if the static evaluation is far below alpha. */
+
+        bool check_extensions = true;
+        /* Search checking moves one ply deeper. */
+
+        int multipv = 1;
+        /* Number of best root moves to search with exact scores. */
+    };
+
+    class Search
+    {
+        /*
+        A single-threaded principal variation search over
+        :func:`~Board::generate_legal_moves()`, with a quiescence search on
+        captures and promotions and the selectivity of
+        :class:`SearchOptions`.
+
+        Quiet moves are ordered by killer moves, counter moves, butterfly
+        history and continuation history. All tables belong to the instance,
+        so every search thread should own its own :class:`Search`. The
+        instance is large; allocate it on the heap.
+        */
+
+    public:
+        Board board;
+        /* The root position. Restored after every search. */
+
+        ButterflyHistory main_history;
+
+        ContinuationHistory continuation_history;
+
+        KillerMoves killers;
+
+        CounterMoves counter_moves;
+
+        SearchOptions options;
+
+        SearchLimits limits;
+
+        TimeManager time;
+
+        std::atomic<bool> stop{false};
+        /* Set from any thread to abort the search as soon as possible. */
+
+        std::atomic<bool> pondering{false};
+        /* While set, the clock does not limit the search. */
+
+        SearchStats stats;
+
+        std::atomic<uint64_t> nodes_searched{0};
+        /*
+        A copy of ``stats.nodes``, published every
+        :data:`TIME_CHECK_INTERVAL` nodes so that other threads can read it.
+        */
+
+        std::vector<Move> pv;
+        /* The principal variation of the last completed iteration. */
+
+        std::vector<std::vector<Move>> pvs;
+        /*
+        The principal variations of the last completed iteration, one per
+        :data:`~SearchOptions::multipv` line, best first. ``pvs[0]`` is
+        :data:`~Search::pv`.
+        */
+
+        std::vector<Value> pv_values;
+        /* The scores of :data:`~Search::pvs`. */
+
+        int completed_depth = 0;
+        /* The depth of the last completed iteration. */
+
+        int thread_index = 0;
+        /*
+        The index of the owning thread. Helper threads (index ``> 0``) skip
+        some iterations so that they do not search in lockstep with the main
+        thread.
+        */
+
+        Search(const Board & = Board());
+
+        void clear();
+
+        Value iterate(int, const std::function<void(int, Value)> & = nullptr);
+
+        Value search(Value, Value, int, int);
+
+        Value qsearch(Value, Value, int);
+
+        Value evaluate();
+
+    private:
+        class Frame
+        {
+        public:
+            int piece;
+            Square to_square;
+            ContinuationHistory::PieceTo *continuation;
+        };
+
+        Frame _frames[MAX_PLY + 3];
+
+        uint16_t _pv[MAX_PLY + 1][MAX_PLY + 1];
+
+        int _pv_length[MAX_PLY + 1];
+
+        std::vector<Move> _excluded;
+        /* Root moves already reported on an earlier line of this iteration. */
+
+        size_t _pv_index = 0;
+
+        Frame *_frame(int ply) { return &this->_frames[ply + 2]; }
+
+        void _score_moves(const std::vector<Move> &, std::vector<int> &, int, uint16_t);
+
+        void _update_quiet_stats(const Move &, const std::vector<Move> &, int, int);
+
+        void _update_pv(int, const Move &);
+
+        void _check_limits();
+
+        bool _skip_depth(int) const;
+    };
+
+    Move pick_move(std::vector<Move> &, std::vector<int> &, size_t);
+
+    std::vector<std::vector<int>> _lmr_reductions();
+
+    extern const std::vector<std::vector<int>> LMR_REDUCTIONS;
+#endif // SEARCH_H_INCLUDED
@@ -0,0 +1,333 @@
+#include "selfplay.h"
+#include "binary.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+    void SelfPlayPosition::encode(uint8_t *data) const
+    {
+        /* Writes the position as :data:`SELFPLAY_RECORD_SIZE` bytes at *data*. */
+        std::copy(this->board, this->board + Board::PACKED_SIZE, data);
+        put_le(data + 32, uint16_t(this->score), 2);
+        put_le(data + 34, this->move, 2);
+        put_le(data + 36, uint8_t(this->result), 1);
+        data[37] = 0;
+    }
+
+    void SelfPlayPosition::decode(const uint8_t *data)
+    {
+        /* Reads the position from :data:`SELFPLAY_RECORD_SIZE` bytes at *data*. */
+        std::copy(data, data + Board::PACKED_SIZE, this->board);
+        this->score = int16_t(get_le(data + 32, 2));
+        this->move = get_le(data + 34, 2);
+        this->result = int8_t(get_le(data + 36, 1));
+    }
+
+    double SelfPlayStats::games_per_hour() const
+    {
+        return this->seconds > 0 ? this->games * 3600 / this->seconds : 0;
+    }
+
+    double SelfPlayStats::positions_per_second() const
+    {
+        return this->seconds > 0 ? this->positions / this->seconds : 0;
+    }
+
+    static bool _read_header(std::istream &in, uint64_t &games, uint64_t &positions)
+    {
+        // Reads the header of a self-play file, false if it is not one.
+        uint8_t header[SELFPLAY_HEADER_SIZE];
+        if (!in.read((char *)header, SELFPLAY_HEADER_SIZE) ||
+            get_le(header, 4) != SELFPLAY_MAGIC || get_le(header + 4, 4) != SELFPLAY_VERSION)
+        {
+            return false;
+        }
+        games = get_le(header + 8, 8);
+        positions = get_le(header + 16, 8);
+        return true;
+    }
+
+    static void _write_header(std::ostream &out, uint64_t games, uint64_t positions)
+    {
+        uint8_t header[SELFPLAY_HEADER_SIZE] = {};
+        put_le(header, SELFPLAY_MAGIC, 4);
+        put_le(header + 4, SELFPLAY_VERSION, 4);
+        put_le(header + 8, games, 8);
+        put_le(header + 16, positions, 8);
+        out.write((const char *)header, SELFPLAY_HEADER_SIZE);
+    }
+
+    static int8_t _play_game(Search &search, std::mt19937_64 &random, const SelfPlayOptions &options,
+                             std::vector<SelfPlayPosition> &positions, std::vector<Bitboard> &keys, uint64_t &nodes)
+    {
+        // Plays one game from random opening moves, recording every searched
+        // position and its key. Returns the result for white.
+        Board board;
+        std::vector<Move> moves;
+        do
+        {
+            // Start over if the random moves end the game.
+            board.reset();
+            moves = board.generate_legal_moves();
+            for (int ply = 0; ply < options.random_plies && !moves.empty(); ++ply)
+            {
+                board.push(moves[random() % moves.size()]);
+                moves = board.generate_legal_moves();
+            }
+        } while (moves.empty());
+
+        search.clear();
+        int depth = options.depth ? std::min(options.depth, MAX_PLY - 1) : MAX_PLY - 1;
+        for (int ply = options.random_plies; ply < options.random_plies + options.max_plies; ++ply)
+        {
+            if (moves.empty())
+            {
+                return board.is_check() ? (board.turn == WHITE ? -1 : 1) : 0;
+            }
+            if (board.is_insufficient_material() || board.is_fifty_moves() || board.is_repetition(3))
+            {
+                return 0;
+            }
+
+            search.board = board;
+            search.stop = false;
+            Value value = search.iterate(depth);
+            nodes += search.stats.nodes;
+            Move move = search.pv.empty() ? moves.front() : search.pv.front();
+
+            SelfPlayPosition &position = positions.emplace_back();
+            board.pack(position.board);
+            position.score = int16_t(std::clamp(value, -VALUE_MATE, VALUE_MATE));
+            position.move = board.encode_move(move);
+            position.result = board.turn == WHITE ? 1 : -1;
+            keys.push_back(board.zobrist_key());
+
+            board.push(move);
+            moves = board.generate_legal_moves();
+        }
+        return 0;
+    }
+
+    SelfPlayStats generate_selfplay(const std::string &path, const SelfPlayOptions &options, const std::function<void(const SelfPlayStats &)> &on_flush)
+    {
+        /*
+        Plays games of the engine against itself and writes their positions
+        to the self-play file at *path* (see :class:`SelfPlayPosition`),
+        until it holds :data:`~SelfPlayOptions::games` games.
+
+        Every thread plays one game at a time with its own :class:`Search`.
+        A game starts with :data:`~SelfPlayOptions::random_plies` random
+        moves, then every move is searched to the node or depth limit, and
+        the position, score and best move are recorded. Finished games are
+        buffered and written every :data:`~SelfPlayOptions::flush_games`
+        games, when *on_flush* is called with the counters so far.
+
+        An existing file is resumed: a write cut short by an interruption
+        is truncated away, and the new games get new random openings. The
+        random moves of a game only depend on the seed and the index of the
+        game, not on the threads.
+
+        An exception thrown by a worker or by *on_flush* stops the workers
+        from starting new games. It is rethrown once they have finished
+        and the games played so far are written.
+
+        :throws: :exc:`std::invalid_argument` if neither nodes nor depth
+            are limited.
+        :throws: :exc:`std::runtime_error` if the file is not a self-play
+            file or cannot be written.
+        */
+        if (!options.nodes && !options.depth)
+        {
+            throw std::invalid_argument("self-play needs a node or depth limit");
+        }
+        auto ts = std::chrono::steady_clock::now();
+        SelfPlayStats stats;
+        std::unordered_set<Bitboard> seen;
+
+        if (std::filesystem::exists(path) && std::filesystem::file_size(path))
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (!_read_header(in, stats.resumed_games, stats.resumed_positions) ||
+                std::filesystem::file_size(path) < SELFPLAY_HEADER_SIZE + stats.resumed_positions * SELFPLAY_RECORD_SIZE)
+            {
+                throw std::runtime_error("not a self-play file: " + path);
+            }
+            if (options.deduplicate)
+            {
+                std::vector<uint8_t> data(SELFPLAY_RECORD_SIZE * 4096);
+                Board board;
+                for (uint64_t i = 0; i < stats.resumed_positions;)
+                {
+                    size_t count = std::min<uint64_t>(stats.resumed_positions - i, 4096);
+                    in.read((char *)data.data(), count * SELFPLAY_RECORD_SIZE);
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        board.unpack(data.data() + j * SELFPLAY_RECORD_SIZE);
+                        seen.insert(board.zobrist_key());
+                    }
+                    i += count;
+                }
+            }
+            in.close();
+            std::filesystem::resize_file(path, SELFPLAY_HEADER_SIZE + stats.resumed_positions * SELFPLAY_RECORD_SIZE);
+        }
+        else
+        {
+            std::ofstream out(path, std::ios::binary);
+            _write_header(out, 0, 0);
+            if (!out)
+            {
+                throw std::runtime_error("cannot write " + path);
+            }
+        }
+
+        std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        out.seekp(0, std::ios::end);
+
+        std::mutex mutex;
+        std::vector<uint8_t> buffer;
+        size_t buffered_games = 0;
+        bool failed = false;
+        std::exception_ptr error;
+        std::atomic<uint64_t> next_game = stats.resumed_games;
+
+        // Appends the buffer and rewrites the header. Called with the mutex held.
+        auto flush = [&]
+        {
+            out.write((const char *)buffer.data(), buffer.size());
+            out.seekp(0);
+            _write_header(out, stats.resumed_games + stats.games, stats.resumed_positions + stats.positions);
+            out.seekp(0, std::ios::end);
+            out.flush();
+            failed |= !out;
+            buffer.clear();
+            buffered_games = 0;
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+            if (on_flush)
+            {
+                on_flush(stats);
+            }
+        };
+
+        auto play_games = [&]
+        {
+            std::unique_ptr<Search> search = std::make_unique<Search>();
+            search->limits.nodes = options.nodes;
+            std::vector<SelfPlayPosition> positions;
+            std::vector<Bitboard> keys;
+            for (uint64_t game = next_game++; game < options.games; game = next_game++)
+            {
+                std::mt19937_64 random(options.seed * 0x9E3779B97F4A7C15 + game);
+                positions.clear();
+                keys.clear();
+                uint64_t nodes = 0;
+                int8_t result = _play_game(*search, random, options, positions, keys, nodes);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t i = 0; i < positions.size(); ++i)
+                {
+                    if (options.deduplicate && !seen.insert(keys[i]).second)
+                    {
+                        ++stats.duplicates;
+                        continue;
+                    }
+                    // The result was stored as the side to move.
+                    positions[i].result *= result;
+                    buffer.resize(buffer.size() + SELFPLAY_RECORD_SIZE);
+                    positions[i].encode(buffer.data() + buffer.size() - SELFPLAY_RECORD_SIZE);
+                    ++stats.positions;
+                }
+                ++stats.games;
+                (result > 0 ? stats.white : result < 0 ? stats.black : stats.draws) += 1;
+                stats.nodes += nodes;
+                if (++buffered_games >= std::max<size_t>(options.flush_games, 1))
+                {
+                    flush();
+                }
+            }
+        };
+
+        auto work = [&]
+        {
+            try
+            {
+                play_games();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                next_game = options.games;
+            }
+        };
+
+        size_t threads = worker_threads(options.threads);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(work);
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        if (buffered_games)
+        {
+            flush();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+        out.close();
+        if (failed || !out)
+        {
+            throw std::runtime_error("cannot write " + path);
+        }
+        return stats;
+    }
+
+    std::vector<SelfPlayPosition> read_selfplay(const std::string &path)
+    {
+        /*
+        Reads the positions of the self-play file at *path*, ignoring
+        anything after those counted in its header.
+
+        :throws: :exc:`std::runtime_error` if the file cannot be read or is
+            not a self-play file.
+        */
+        std::ifstream in(path, std::ios::binary);
+        uint64_t games, count;
+        if (!in || !_read_header(in, games, count))
+        {
+            throw std::runtime_error("not a self-play file: " + path);
+        }
+        std::vector<uint8_t> data(count * SELFPLAY_RECORD_SIZE);
+        if (!in.read((char *)data.data(), data.size()))
+        {
+            throw std::runtime_error("truncated self-play file: " + path);
+        }
+        std::vector<SelfPlayPosition> positions(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            positions[i].decode(data.data() + i * SELFPLAY_RECORD_SIZE);
+        }
+        return positions;
+    }
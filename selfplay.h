@@ -0,0 +1,114 @@
+#ifndef SELFPLAY_H_INCLUDED
+#define SELFPLAY_H_INCLUDED
+#include "search.h"
+
+    const uint32_t SELFPLAY_MAGIC = 0x53435043;
+    /* ``CPCS`` as the first four bytes of a self-play file. */
+
+    const uint32_t SELFPLAY_VERSION = 1;
+
+    const size_t SELFPLAY_HEADER_SIZE = 32;
+
+    const size_t SELFPLAY_RECORD_SIZE = 38;
+
+    class SelfPlayPosition
+    {
+        /*
+        A position of a self-play file written by :func:`generate_selfplay()`.
+
+        The file is a header and the positions in the order their games
+        finished. All numbers are little-endian.
+
+        - header: ``uint32_t`` :data:`SELFPLAY_MAGIC` and
+          :data:`SELFPLAY_VERSION`, ``uint64_t`` the number of games and of
+          positions, 8 bytes reserved
+        - position: the board packed by :func:`Board::pack()`, ``int16_t``
+          score, ``uint16_t`` best move encoded by
+          :func:`~Board::encode_move()`, ``int8_t`` result, 1 byte reserved
+
+        The header is rewritten after every flush, so it only counts
+        positions that are completely written.
+        */
+
+    public:
+        uint8_t board[Board::PACKED_SIZE] = {};
+
+        int16_t score = 0;
+        /* The search score, from the point of view of the side to move. */
+
+        uint16_t move = 0;
+
+        int8_t result = 0;
+        /* The result of the game for the side to move: 1 won, 0 drawn, -1 lost. */
+
+        void encode(uint8_t *) const;
+
+        void decode(const uint8_t *);
+    };
+
+    class SelfPlayOptions
+    {
+        /* How :func:`generate_selfplay()` plays. */
+
+    public:
+        size_t games = 1000;
+        /* Games the file should hold, including those already in it. */
+
+        size_t threads = 0;
+        /* Concurrent games, one per thread; 0 for one per hardware thread. */
+
+        uint64_t nodes = 5000;
+        /* Nodes per move; 0 for no limit. */
+
+        int depth = 0;
+        /* Depth per move; 0 for no limit. At least one of *nodes* and *depth* must be set. */
+
+        int random_plies = 8;
+        /* Random moves at the start of every game, not recorded. */
+
+        int max_plies = 400;
+        /* Games still running after this many plies are drawn. */
+
+        size_t flush_games = 64;
+        /* Finished games buffered before being written to the file. */
+
+        bool deduplicate = true;
+        /* Skip positions already in the file, by :func:`~Board::zobrist_key()`. */
+
+        uint64_t seed = 0;
+        /* With the index of a game, seeds its random moves. */
+    };
+
+    class SelfPlayStats
+    {
+        /* Counters of a :func:`generate_selfplay()` call. */
+
+    public:
+        uint64_t resumed_games = 0, resumed_positions = 0;
+        /* Games and positions already in the file. */
+
+        uint64_t games = 0;
+        /* Games played by this call. */
+
+        uint64_t white = 0, draws = 0, black = 0;
+        /* Games won by white, drawn and won by black. */
+
+        uint64_t positions = 0;
+        /* Positions written. */
+
+        uint64_t duplicates = 0;
+        /* Positions skipped by :data:`~SelfPlayOptions::deduplicate`. */
+
+        uint64_t nodes = 0;
+
+        double seconds = 0;
+
+        double games_per_hour() const;
+
+        double positions_per_second() const;
+    };
+
+    SelfPlayStats generate_selfplay(const std::string &, const SelfPlayOptions & = SelfPlayOptions(), const std::function<void(const SelfPlayStats &)> & = nullptr);
+
+    std::vector<SelfPlayPosition> read_selfplay(const std::string &);
+#endif // SELFPLAY_H_INCLUDED
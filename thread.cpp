@@ -0,0 +1,330 @@
+#include "thread.h"
+
+    SearchThread::SearchThread() : _search(std::make_unique<Search>())
+    {
+        this->_thread = std::thread(&SearchThread::_idle_loop, this);
+    }
+
+    SearchThread::~SearchThread()
+    {
+        this->stop();
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_exit = true;
+        }
+        this->_cv.notify_all();
+        this->_thread.join();
+    }
+
+    void SearchThread::go(const Board &board, const SearchLimits &limits)
+    {
+        /*
+        Starts searching *board* within *limits* and returns immediately.
+        A search that is still running is stopped first.
+        */
+        if (this->searching())
+        {
+            this->stop();
+            this->wait();
+        }
+
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_search->board = board;
+        this->_search->limits = limits;
+        this->_search->stop = false;
+        this->_search->pondering = limits.ponder;
+        this->_search->time.init(limits, board.turn);
+        this->_searching = true;
+        this->_cv.notify_all();
+    }
+
+    void SearchThread::stop()
+    {
+        /* Asks the search to stop. Does not wait for it. */
+        this->_search->stop = true;
+    }
+
+    void SearchThread::ponderhit()
+    {
+        /*
+        The opponent played the expected move: the ponder search continues
+        as a normal search, with the clock started now.
+        */
+        this->_search->time.restart();
+        this->_search->pondering = false;
+    }
+
+    void SearchThread::wait()
+    {
+        /* Blocks until the current search (if any) has reported its best move. */
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_cv.wait(lock, [this]
+                       { return !this->_searching; });
+    }
+
+    bool SearchThread::searching() const
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        return this->_searching;
+    }
+
+    Search &SearchThread::search()
+    {
+        /*
+        The search state owned by this thread. Only access it while the
+        thread is not searching.
+        */
+        return *this->_search;
+    }
+
+    void SearchThread::set_move_overhead(int64_t move_overhead)
+    {
+        this->_search->time.move_overhead = move_overhead;
+    }
+
+    void SearchThread::_idle_loop()
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_cv.wait(lock, [this]
+                           { return this->_searching || this->_exit; });
+            if (this->_exit)
+            {
+                return;
+            }
+            lock.unlock();
+
+            this->_run();
+
+            lock.lock();
+            this->_searching = false;
+            lock.unlock();
+            this->_cv.notify_all();
+        }
+    }
+
+    void SearchThread::_run()
+    {
+        Search &search = *this->_search;
+        int depth = search.limits.depth ? std::min(search.limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+
+        std::function<void(int, Value)> on_iteration = nullptr;
+        if (this->on_iteration)
+        {
+            on_iteration = [this, &search](int d, Value value)
+            { this->on_iteration(search, d, value); };
+        }
+        search.iterate(depth, on_iteration);
+
+        // Infinite and ponder searches must not report before being told to.
+        while (!search.stop && (search.limits.infinite || search.pondering))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        Move best_move = Move::null();
+        Move ponder_move = Move::null();
+        if (!search.pv.empty())
+        {
+            best_move = search.pv[0];
+            if (search.pv.size() > 1)
+            {
+                ponder_move = search.pv[1];
+            }
+        }
+        else
+        {
+            std::vector<Move> moves = search.board.generate_legal_moves();
+            if (!moves.empty())
+            {
+                best_move = moves.front();
+            }
+        }
+
+        if (this->on_bestmove)
+        {
+            this->on_bestmove(best_move, ponder_move);
+        }
+    }
+
+    SearchThreads::SearchThreads(size_t size)
+    {
+        this->set_size(size);
+    }
+
+    void SearchThreads::set_size(size_t size)
+    {
+        /*
+        Sets the number of threads, at least one. Waits for a running search
+        to finish; the new threads start with empty tables.
+        */
+        size = std::max<size_t>(size, 1);
+        this->stop();
+        this->wait();
+
+        this->_threads.resize(std::min(size, this->_threads.size()));
+        while (this->_threads.size() < size)
+        {
+            this->_threads.push_back(std::make_unique<SearchThread>());
+        }
+
+        for (size_t i = 0; i < this->_threads.size(); ++i)
+        {
+            SearchThread &thread = *this->_threads[i];
+            thread.search().thread_index = int(i);
+            thread.search().options = this->_options;
+            thread.set_move_overhead(this->_move_overhead);
+        }
+
+        SearchThread &main = *this->_threads.front();
+        main.on_iteration = [this](const Search &search, int depth, Value value)
+        {
+            if (this->on_iteration)
+            {
+                this->on_iteration(search, depth, value);
+            }
+        };
+        main.on_bestmove = [this](const Move &best_move, const Move &ponder_move)
+        { this->_on_main_bestmove(best_move, ponder_move); };
+    }
+
+    size_t SearchThreads::size() const
+    {
+        return this->_threads.size();
+    }
+
+    void SearchThreads::set_options(const SearchOptions &options)
+    {
+        /* Sets the options of all threads. Waits for a running search to finish. */
+        this->wait();
+        this->_options = options;
+        for (auto &thread : this->_threads)
+        {
+            thread->search().options = options;
+        }
+    }
+
+    void SearchThreads::set_move_overhead(int64_t move_overhead)
+    {
+        this->_move_overhead = move_overhead;
+        for (auto &thread : this->_threads)
+        {
+            thread->set_move_overhead(move_overhead);
+        }
+    }
+
+    void SearchThreads::go(const Board &board, const SearchLimits &limits)
+    {
+        /*
+        Starts all threads on *board* and returns immediately. A search that
+        is still running is stopped first.
+        */
+        this->stop();
+        this->wait();
+
+        // Helpers start first, so that they are searching by the time the
+        // main thread could finish.
+        for (size_t i = this->_threads.size(); i-- > 0;)
+        {
+            this->_threads[i]->go(board, limits);
+        }
+    }
+
+    void SearchThreads::stop()
+    {
+        for (auto &thread : this->_threads)
+        {
+            thread->stop();
+        }
+    }
+
+    void SearchThreads::ponderhit()
+    {
+        for (auto &thread : this->_threads)
+        {
+            thread->ponderhit();
+        }
+    }
+
+    void SearchThreads::wait()
+    {
+        /* Blocks until the main thread has reported and all helpers are idle. */
+        for (auto &thread : this->_threads)
+        {
+            thread->wait();
+        }
+    }
+
+    bool SearchThreads::searching() const
+    {
+        return !this->_threads.empty() && this->_threads.front()->searching();
+    }
+
+    void SearchThreads::clear()
+    {
+        /* Clears the tables of all threads, e.g., for a new game. */
+        this->stop();
+        this->wait();
+        for (auto &thread : this->_threads)
+        {
+            thread->search().clear();
+        }
+    }
+
+    uint64_t SearchThreads::nodes_searched() const
+    {
+        /* The nodes searched by all threads. Safe to call while searching. */
+        uint64_t nodes = 0;
+        for (const auto &thread : this->_threads)
+        {
+            nodes += thread->search().nodes_searched.load(std::memory_order_relaxed);
+        }
+        return nodes;
+    }
+
+    Search &SearchThreads::main()
+    {
+        return this->_threads.front()->search();
+    }
+
+    void SearchThreads::_on_main_bestmove(const Move &best_move, const Move &ponder_move)
+    {
+        // Runs on the main search thread, after its search has finished.
+        for (size_t i = 1; i < this->_threads.size(); ++i)
+        {
+            this->_threads[i]->stop();
+        }
+        for (size_t i = 1; i < this->_threads.size(); ++i)
+        {
+            this->_threads[i]->wait();
+        }
+
+        // With several lines, the main thread's lines are the ones reported.
+        Search *best = &this->main();
+        for (size_t i = 1; i < this->_threads.size() && this->_options.multipv == 1; ++i)
+        {
+            Search &search = this->_threads[i]->search();
+            if (search.pv.empty() || best->pv.empty())
+            {
+                continue;
+            }
+            if (search.completed_depth > best->completed_depth ||
+                (search.completed_depth == best->completed_depth && search.pv_values.front() > best->pv_values.front()))
+            {
+                best = &search;
+            }
+        }
+
+        if (this->on_bestmove)
+        {
+            if (best == &this->main())
+            {
+                this->on_bestmove(*best, best_move, ponder_move);
+            }
+            else
+            {
+                this->on_bestmove(*best, best->pv[0], best->pv.size() > 1 ? best->pv[1] : Move::null());
+            }
+        }
+    }
@@ -0,0 +1,130 @@
+#ifndef THREAD_H_INCLUDED
+#define THREAD_H_INCLUDED
+#include "search.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+    class SearchThread
+    {
+        /*
+        Runs a :class:`Search` on a background thread.
+
+        :func:`~SearchThread::go()` hands a position and limits to the thread
+        and returns immediately. :func:`~SearchThread::stop()` and
+        :func:`~SearchThread::ponderhit()` only set atomic flags, so they are
+        safe to call from any thread at any time.
+
+        When the search finishes, *on_bestmove* is called on the search
+        thread with the best move and the expected reply (possibly a null
+        move). Infinite and ponder searches never finish on their own: they
+        wait for :func:`~SearchThread::stop()` (or
+        :func:`~SearchThread::ponderhit()`) before reporting.
+        */
+
+    public:
+        std::function<void(const Search &, int, Value)> on_iteration;
+        /* Called on the search thread after every completed iteration. */
+
+        std::function<void(const Move &, const Move &)> on_bestmove;
+        /* Called on the search thread with the best move and ponder move. */
+
+        SearchThread();
+
+        ~SearchThread();
+
+        SearchThread(const SearchThread &) = delete;
+
+        SearchThread &operator=(const SearchThread &) = delete;
+
+        void go(const Board &, const SearchLimits &);
+
+        void stop();
+
+        void ponderhit();
+
+        void wait();
+
+        bool searching() const;
+
+        Search &search();
+
+        void set_move_overhead(int64_t);
+
+    private:
+        std::unique_ptr<Search> _search;
+
+        std::thread _thread;
+
+        mutable std::mutex _mutex;
+
+        std::condition_variable _cv;
+
+        bool _searching = false;
+
+        bool _exit = false;
+
+        void _idle_loop();
+
+        void _run();
+    };
+
+    class SearchThreads
+    {
+        /*
+        A group of :class:`SearchThread` instances searching the same
+        position: the main thread, which owns the clock and reports, and
+        helper threads.
+
+        The threads share no tables; helpers only differ by skipping some
+        iterations (see :data:`~Search::thread_index`). When the main thread
+        finishes, the helpers are stopped and the thread with the deepest
+        completed iteration (then the best score) decides the best move.
+        */
+
+    public:
+        std::function<void(const Search &, int, Value)> on_iteration;
+        /* Called on the main search thread after every completed iteration. */
+
+        std::function<void(const Search &, const Move &, const Move &)> on_bestmove;
+        /*
+        Called on the main search thread with the search of the selected
+        thread, the best move and the ponder move.
+        */
+
+        SearchThreads(size_t = 1);
+
+        void set_size(size_t);
+
+        size_t size() const;
+
+        void set_options(const SearchOptions &);
+
+        void set_move_overhead(int64_t);
+
+        void go(const Board &, const SearchLimits &);
+
+        void stop();
+
+        void ponderhit();
+
+        void wait();
+
+        bool searching() const;
+
+        void clear();
+
+        uint64_t nodes_searched() const;
+
+        Search &main();
+
+    private:
+        std::vector<std::unique_ptr<SearchThread>> _threads;
+
+        SearchOptions _options;
+
+        int64_t _move_overhead = 10;
+
+        void _on_main_bestmove(const Move &, const Move &);
+    };
+#endif // THREAD_H_INCLUDED
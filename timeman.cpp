@@ -0,0 +1,60 @@
+#include "timeman.h"
+
+    bool SearchLimits::use_time_management() const
+    {
+        /* Checks if the search is bounded by the clock. */
+        return this->time[WHITE] || this->time[BLACK] || this->movetime;
+    }
+
+    void TimeManager::init(const SearchLimits &limits, Color us)
+    {
+        /*
+        Starts the clock and computes the limits for *us*.
+
+        With a fixed *movetime*, both limits are the movetime less the move
+        overhead. Otherwise the remaining time plus the increments still to
+        come is split evenly over the moves to go (assumed ``40`` in sudden
+        death), giving the soft limit. The hard limit allows five times as
+        much, but never more than 80% of the clock.
+        */
+        this->restart();
+        this->enabled = limits.use_time_management();
+        if (!this->enabled)
+        {
+            this->soft_limit = this->hard_limit = 0;
+            return;
+        }
+
+        if (limits.movetime)
+        {
+            this->soft_limit = this->hard_limit = std::max<int64_t>(1, limits.movetime - this->move_overhead);
+            return;
+        }
+
+        int64_t time = limits.time[us];
+        int64_t inc = limits.inc[us];
+        int movestogo = limits.movestogo ? std::min(limits.movestogo, 50) : 40;
+
+        int64_t time_left = std::max<int64_t>(1, time + inc * (movestogo - 1) - this->move_overhead * (2 + movestogo));
+        int64_t maximum = std::max<int64_t>(1, time * 8 / 10 - this->move_overhead);
+
+        this->soft_limit = std::min(time_left / movestogo, maximum);
+        this->hard_limit = std::min(this->soft_limit * 5, maximum);
+    }
+
+    void TimeManager::restart()
+    {
+        this->_start = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t TimeManager::elapsed() const
+    {
+        /* Milliseconds since the clock was (re)started. */
+        return this->elapsed_us() / 1000;
+    }
+
+    int64_t TimeManager::elapsed_us() const
+    {
+        /* Microseconds since the clock was (re)started. */
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - this->_start;
+    }
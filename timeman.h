@@ -0,0 +1,78 @@
+#ifndef TIMEMAN_H_INCLUDED
+#define TIMEMAN_H_INCLUDED
+#include "Move.h"
+#include "types.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+    class SearchLimits
+    {
+        /*
+        The limits of a search, as given by the UCI ``go`` command. Times are
+        in milliseconds, ``0`` means no limit.
+        */
+
+    public:
+        int64_t time[2] = {0, 0};
+        /* Remaining clock time per color (``wtime``/``btime``). */
+
+        int64_t inc[2] = {0, 0};
+        /* Increment per move per color (``winc``/``binc``). */
+
+        int movestogo = 0;
+        /* Moves until the next time control, ``0`` for sudden death. */
+
+        int64_t movetime = 0;
+        /* Exact time to search. */
+
+        int depth = 0;
+
+        uint64_t nodes = 0;
+
+        int mate = 0;
+        /* Search for a mate in this many moves. */
+
+        bool infinite = false;
+        /* Search until stopped. */
+
+        bool ponder = false;
+        /* Start in ponder mode: no time limits until ponderhit. */
+
+        std::vector<Move> searchmoves;
+        /* Restricts the root moves to these, if not empty. */
+
+        bool use_time_management() const;
+    };
+
+    class TimeManager
+    {
+        /*
+        Allocates a soft limit, after which no new iteration is started, and
+        a hard limit, at which a running iteration is aborted, from the clock
+        situation. The clock is a steady clock, safe to read and restart from
+        any thread.
+        */
+
+    public:
+        int64_t move_overhead = 10;
+        /* Time reserved per move for communication and GUI lag. */
+
+        bool enabled = false;
+
+        int64_t soft_limit = 0;
+
+        int64_t hard_limit = 0;
+
+        void init(const SearchLimits &, Color);
+
+        void restart();
+
+        int64_t elapsed() const;
+
+        int64_t elapsed_us() const;
+
+    private:
+        std::atomic<int64_t> _start{0};
+    };
+#endif // TIMEMAN_H_INCLUDED
@@ -0,0 +1,137 @@
+// allocations.cpp : Checks that the lookups documented as allocation-free
+// make no heap allocation.
+//
+// It replaces the global operator new to count allocations, so it is not
+// part of the engine: build it as its own program from the engine sources
+// without main.cpp, e.g. from the repository root:
+//
+//     g++ -std=c++20 -O2 -pthread -o allocations tools/allocations.cpp $(ls *.cpp | grep -v main.cpp)
+//
+// and run it as "allocations games.pgn [plies]". It exits with 1 if a
+// lookup allocates.
+#include "../polyglot.h"
+#include "../explorer.h"
+#include "../pgn.h"
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+
+    static thread_local uint64_t _allocations = 0;
+    /* Heap allocations of the calling thread, counted by the operators below. */
+
+    static void *_allocate(size_t size)
+    {
+        ++_allocations;
+        if (void *data = std::malloc(size ? size : 1))
+        {
+            return data;
+        }
+        throw std::bad_alloc();
+    }
+
+    void *operator new(size_t size)
+    {
+        return _allocate(size);
+    }
+
+    void *operator new[](size_t size)
+    {
+        return _allocate(size);
+    }
+
+    void operator delete(void *data) noexcept
+    {
+        std::free(data);
+    }
+
+    void operator delete[](void *data) noexcept
+    {
+        std::free(data);
+    }
+
+    void operator delete(void *data, size_t) noexcept
+    {
+        std::free(data);
+    }
+
+    void operator delete[](void *data, size_t) noexcept
+    {
+        std::free(data);
+    }
+
+    static void _opening_positions(const std::string &pgn_path, int plies, std::vector<Board> &boards)
+    {
+        // The positions of the first *plies* of the games in the PGN file
+        // at *pgn_path*.
+        read_pgn_file(pgn_path, [&](const PgnGame &game)
+                      {
+                          Board board = game.board;
+                          while (!board.move_stack.empty())
+                          {
+                              board.pop();
+                          }
+                          for (size_t ply = 0; ply < game.moves.size() && ply < size_t(plies); ++ply)
+                          {
+                              boards.push_back(board);
+                              boards.back().clear_stack();
+                              board.push(game.moves[ply]);
+                          }
+                          return true;
+                      });
+    }
+
+    static bool _report(const std::string &name, uint64_t allocations, size_t calls)
+    {
+        // Prints the allocations of *calls* calls of *name*, and whether there were any.
+        std::cout << name << ": " << allocations << " allocations in " << calls << " calls" << (allocations ? " (ALLOCATES)" : " (none)") << std::endl;
+        return allocations > 0;
+    }
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: allocations games.pgn [plies]" << std::endl;
+        return 2;
+    }
+    std::string pgn_path = argv[1];
+    int plies = argc > 2 ? std::stoi(argv[2]) : 20;
+    std::vector<Board> boards;
+    _opening_positions(pgn_path, plies, boards);
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    bool allocates = false;
+
+    std::string book_path = (directory / "cppchess-allocations.bin").string();
+    PolyglotBuildOptions book_options;
+    book_options.plies = plies;
+    build_polyglot_book(pgn_path, book_path, book_options);
+    {
+        PolyglotBook book(book_path);
+        PolyglotEntry entries[256];
+        uint64_t allocations = _allocations;
+        for (const Board &board : boards)
+        {
+            book.find_all(board, entries, std::size(entries));
+        }
+        allocates |= _report("PolyglotBook::find_all()", _allocations - allocations, boards.size());
+    }
+    std::filesystem::remove(book_path);
+
+    std::string index_path = (directory / "cppchess-allocations.explorer").string();
+    MoveCountOptions index_options;
+    index_options.plies = plies;
+    build_explorer_index(pgn_path, index_path, index_options);
+    {
+        ExplorerIndex index(index_path);
+        ExplorerMove results[256];
+        uint64_t allocations = _allocations;
+        for (const Board &board : boards)
+        {
+            index.query(board, results, std::size(results));
+        }
+        allocates |= _report("ExplorerIndex::query()", _allocations - allocations, boards.size());
+    }
+    std::filesystem::remove(index_path);
+    return allocates;
+}
@@ -0,0 +1,269 @@
+#include "trainfeatures.h"
+#include <algorithm>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FEATURES_X86
+#endif
+
+    class _FeatureKernels
+    {
+        // Expanding bitboards to one value per square. The implementation is
+        // selected once at runtime.
+
+    public:
+        const char *name;
+
+        void (*expand_u8)(const Bitboard *, int, uint8_t *);
+        /* Writes 64 bytes of 0 or 1 for each of the bitboards. */
+
+        void (*expand_f32)(const Bitboard *, int, float *);
+        /* Writes 64 floats of 0 or 1 for each of the bitboards. */
+    };
+
+    static void _expand_u8_scalar(const Bitboard *planes, int count, uint8_t *output)
+    {
+        for (int i = 0; i < count; ++i, output += 64)
+        {
+            for (int square = 0; square < 64; ++square)
+            {
+                output[square] = (planes[i] >> square) & 1;
+            }
+        }
+    }
+
+    static void _expand_f32_scalar(const Bitboard *planes, int count, float *output)
+    {
+        for (int i = 0; i < count; ++i, output += 64)
+        {
+            for (int square = 0; square < 64; ++square)
+            {
+                output[square] = float((planes[i] >> square) & 1);
+            }
+        }
+    }
+
+#ifdef FEATURES_X86
+    __attribute__((target("avx2"))) static void _expand_u8_avx2(const Bitboard *planes, int count, uint8_t *output)
+    {
+        // Each byte gets the byte of the bitboard holding its square, then
+        // is compared with the bit of its square.
+        const __m256i shuffle = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                                 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        const __m256i bits = _mm256_set1_epi64x(0x8040201008040201);
+        const __m256i ones = _mm256_set1_epi8(1);
+        for (int i = 0; i < count; ++i, output += 64)
+        {
+            for (int half = 0; half < 2; ++half)
+            {
+                __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(int32_t(planes[i] >> (32 * half))), shuffle);
+                v = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits), ones);
+                _mm256_storeu_si256((__m256i *)(output + 32 * half), v);
+            }
+        }
+    }
+
+    __attribute__((target("avx2"))) static void _expand_f32_avx2(const Bitboard *planes, int count, float *output)
+    {
+        const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        const __m256 ones = _mm256_set1_ps(1.0f);
+        for (int i = 0; i < count; ++i, output += 64)
+        {
+            for (int rank = 0; rank < 8; ++rank)
+            {
+                __m256i v = _mm256_set1_epi32(int32_t((planes[i] >> (8 * rank)) & 0xFF));
+                __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(v, bits), bits);
+                _mm256_storeu_ps(output + 8 * rank, _mm256_and_ps(_mm256_castsi256_ps(mask), ones));
+            }
+        }
+    }
+#endif
+
+    static const _FeatureKernels &_feature_kernels()
+    {
+        static const _FeatureKernels kernels = []
+        {
+#ifdef FEATURES_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return _FeatureKernels{"AVX2", _expand_u8_avx2, _expand_f32_avx2};
+            }
+#endif
+            return _FeatureKernels{"scalar", _expand_u8_scalar, _expand_f32_scalar};
+        }();
+        return kernels;
+    }
+
+    const char *features_simd()
+    {
+        /* The instruction set used to expand bitplanes. */
+        return _feature_kernels().name;
+    }
+
+    static Color _planes(const Board &board, Bitboard *planes)
+    {
+        // The 12 piece bitboards of *board*, returns the side to move.
+        for (Color color : {WHITE, BLACK})
+        {
+            for (PieceType piece_type = PAWN; piece_type <= KING; ++piece_type)
+            {
+                planes[(color == WHITE ? 0 : 6) + piece_type - 1] = board.pieces_mask(piece_type, color);
+            }
+        }
+        return board.turn;
+    }
+
+    static Color _packed_planes(const uint8_t *data, Bitboard *planes)
+    {
+        // The 12 piece bitboards of a position packed by Board::pack(),
+        // without unpacking the rest of it.
+        Bitboard pieces[7];
+        if (!unpack_pieces(data, pieces))
+        {
+            throw std::invalid_argument("invalid packed board");
+        }
+        for (int i = 0; i < 6; ++i)
+        {
+            planes[i] = pieces[i] & ~pieces[6];
+            planes[6 + i] = pieces[i] & pieces[6];
+        }
+        return data[24] & 1 ? BLACK : WHITE;
+    }
+
+    static void _orient(Bitboard *planes, Color turn, bool relative)
+    {
+        // From the side to move: black's pieces come first and the board is
+        // flipped so they move up.
+        if (relative && turn == BLACK)
+        {
+            for (int i = 0; i < 6; ++i)
+            {
+                Bitboard own = flip_vertical(planes[6 + i]);
+                planes[6 + i] = flip_vertical(planes[i]);
+                planes[i] = own;
+            }
+        }
+    }
+
+    void bitplanes(const Board *boards, size_t count, uint8_t *output, bool relative)
+    {
+        /*
+        Writes :data:`BITPLANES_SIZE` bytes of 0 or 1 for each of the
+        *count* *boards* to *output*, plane by plane, squares in square
+        order. With *relative* the planes are from the point of view of the
+        side to move: its pieces first, and the board flipped vertically if
+        black is to move.
+        */
+        const _FeatureKernels &kernels = _feature_kernels();
+        Bitboard planes[BITPLANES];
+        for (size_t i = 0; i < count; ++i)
+        {
+            _orient(planes, _planes(boards[i], planes), relative);
+            kernels.expand_u8(planes, BITPLANES, output + i * BITPLANES_SIZE);
+        }
+    }
+
+    void bitplanes(const Board *boards, size_t count, float *output, bool relative)
+    {
+        /* Like :func:`bitplanes()`, with floats of 0 or 1. */
+        const _FeatureKernels &kernels = _feature_kernels();
+        Bitboard planes[BITPLANES];
+        for (size_t i = 0; i < count; ++i)
+        {
+            _orient(planes, _planes(boards[i], planes), relative);
+            kernels.expand_f32(planes, BITPLANES, output + i * BITPLANES_SIZE);
+        }
+    }
+
+    void packed_bitplanes(const uint8_t *data, size_t count, uint8_t *output, bool relative)
+    {
+        /*
+        Like :func:`bitplanes()`, for *count* positions packed by
+        :func:`pack_boards()`.
+
+        :throws: :exc:`std::invalid_argument` if a piece code is invalid.
+        */
+        const _FeatureKernels &kernels = _feature_kernels();
+        Bitboard planes[BITPLANES];
+        for (size_t i = 0; i < count; ++i)
+        {
+            _orient(planes, _packed_planes(data + i * Board::PACKED_SIZE, planes), relative);
+            kernels.expand_u8(planes, BITPLANES, output + i * BITPLANES_SIZE);
+        }
+    }
+
+    void packed_bitplanes(const uint8_t *data, size_t count, float *output, bool relative)
+    {
+        /* Like :func:`packed_bitplanes()`, with floats of 0 or 1. */
+        const _FeatureKernels &kernels = _feature_kernels();
+        Bitboard planes[BITPLANES];
+        for (size_t i = 0; i < count; ++i)
+        {
+            _orient(planes, _packed_planes(data + i * Board::PACKED_SIZE, planes), relative);
+            kernels.expand_f32(planes, BITPLANES, output + i * BITPLANES_SIZE);
+        }
+    }
+
+    static size_t _halfkp(const Bitboard *planes, Color turn, int32_t *output)
+    {
+        // Both perspectives, the side to move first, each padded to
+        // HALFKP_SLOTS. Returns the number of active features.
+        size_t active = 0;
+        for (Color perspective : {turn, !turn})
+        {
+            Bitboard kings = planes[(perspective == WHITE ? 0 : 6) + KING - 1];
+            Square king = kings ? lsb(kings) : 0;
+            int slot = 0;
+            for (Color color : {WHITE, BLACK})
+            {
+                for (PieceType piece_type = PAWN; piece_type < KING; ++piece_type)
+                {
+                    for (Bitboard bb = planes[(color == WHITE ? 0 : 6) + piece_type - 1]; bb && slot < HALFKP_SLOTS; bb &= bb - 1)
+                    {
+                        output[slot++] = nnue_feature(perspective, king, color, piece_type, lsb(bb));
+                    }
+                }
+            }
+            active += slot;
+            std::fill(output + slot, output + HALFKP_SLOTS, -1);
+            output += HALFKP_SLOTS;
+        }
+        return active;
+    }
+
+    size_t halfkp_features(const Board *boards, size_t count, int32_t *output)
+    {
+        /*
+        Writes the active HalfKP features of the network (see
+        :func:`nnue_feature()`) of each of the *count* *boards* to *output*:
+        ``2 * HALFKP_SLOTS`` indices per board, those of the side to move
+        first, each perspective padded with -1.
+
+        Returns the number of active features.
+        */
+        Bitboard planes[BITPLANES];
+        size_t active = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            active += _halfkp(planes, _planes(boards[i], planes), output + i * 2 * HALFKP_SLOTS);
+        }
+        return active;
+    }
+
+    size_t packed_halfkp_features(const uint8_t *data, size_t count, int32_t *output)
+    {
+        /*
+        Like :func:`halfkp_features()`, for *count* positions packed by
+        :func:`pack_boards()`.
+
+        :throws: :exc:`std::invalid_argument` if a piece code is invalid.
+        */
+        Bitboard planes[BITPLANES];
+        size_t active = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            active += _halfkp(planes, _packed_planes(data + i * Board::PACKED_SIZE, planes), output + i * 2 * HALFKP_SLOTS);
+        }
+        return active;
+    }
@@ -0,0 +1,27 @@
+#ifndef TRAINFEATURES_H_INCLUDED
+#define TRAINFEATURES_H_INCLUDED
+#include "nnue.h"
+
+    const int BITPLANES = 12;
+    /* Planes of the dense encoding: white pawns, knights, bishops, rooks, queens and kings, then black ones. */
+
+    const size_t BITPLANES_SIZE = BITPLANES * 64;
+    /* Values per position of the dense encoding, a plane of 64 squares each. */
+
+    const int HALFKP_SLOTS = 32;
+    /* Slots per perspective of the sparse encoding: up to 30 pieces besides the kings, padded with -1. */
+
+    void bitplanes(const Board *, size_t, uint8_t *, bool = false);
+
+    void bitplanes(const Board *, size_t, float *, bool = false);
+
+    void packed_bitplanes(const uint8_t *, size_t, uint8_t *, bool = false);
+
+    void packed_bitplanes(const uint8_t *, size_t, float *, bool = false);
+
+    size_t halfkp_features(const Board *, size_t, int32_t *);
+
+    size_t packed_halfkp_features(const uint8_t *, size_t, int32_t *);
+
+    const char *features_simd();
+#endif // TRAINFEATURES_H_INCLUDED
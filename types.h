@@ -26,6 +26,10 @@
     const PieceType PIECE_TYPES[] = {1, 2, 3, 4, 5, 6}, PAWN = 1, KNIGHT = 2, BISHOP = 3, ROOK = 4, QUEEN = 5, KING = 6;
     const std::optional<char> PIECE_SYMBOLS[] = {std::nullopt, 'p', 'n', 'b', 'r', 'q', 'k'};
     const std::optional<std::string> PIECE_NAMES[] = {std::nullopt, "pawn", "knight", "bishop", "rook", "queen", "king"};
+    const int PIECE_VALUES[] = {0, 100, 320, 330, 500, 900, 20000};
+    /* Nominal piece values in centipawns, as used by static exchange evaluation. */
+    const int NON_PAWN_VALUES[] = {0, 0, 781, 825, 1276, 2538, 0};
+    /* Midgame values of the pieces other than pawns and kings, summed into the game phase. */
     typedef std::string _EnPassantSpec;
     const char FILE_NAMES[] = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h'};
 
@@ -184,7 +188,7 @@
     },
                    BB_RANK_1 = 0xffULL << (8 * 0), BB_RANK_2 = 0xffULL << (8 * 1), BB_RANK_3 = 0xffULL << (8 * 2), BB_RANK_4 = 0xffULL << (8 * 3), BB_RANK_5 = 0xffULL << (8 * 4), BB_RANK_6 = 0xffULL << (8 * 5), BB_RANK_7 = 0xffULL << (8 * 6), BB_RANK_8 = 0xffULL << (8 * 7);
 
-    #define BB_BACKRANKS  BB_RANK_1 | BB_RANK_8
+    #define BB_BACKRANKS  (BB_RANK_1 | BB_RANK_8)
 
     #define lsb(bb) std::numeric_limits<Bitboard>::digits - std::countl_zero(bb & -bb) - 1
     inline std::vector<Square> scan_forward(Bitboard bb)
@@ -277,5 +281,5 @@
     const std::regex SAN_REGEX(R"(^([NBKRQ])?([a-h])?([1-8])?[\-x]?([a-h][1-8])(=?[nbrqkNBRQK])?[\+#]?$)");
 
     const std::regex FEN_CASTLING_REGEX(R"(^(?:-|[KQABCDEFGH]{0,2}[kqabcdefgh]{0,2})$)");
-    #define popcount(bb) __builtin_popcount(bb)
+    #define popcount(bb) __builtin_popcountll(bb)
 #endif // TYPES_H_INCLUDED
@@ -0,0 +1,370 @@
+#include "uci.h"
+
+    UCI::UCI(std::istream &in, std::ostream &out) : _in(in), _out(out)
+    {
+        this->_threads.on_iteration = [this](const Search &search, int depth, Value value)
+        { this->_on_iteration(search, depth, value); };
+        this->_threads.on_bestmove = [this](const Search &search, const Move &best_move, const Move &ponder_move)
+        { this->_on_bestmove(search, best_move, ponder_move); };
+    }
+
+    UCI::~UCI()
+    {
+        this->_threads.stop();
+        this->_threads.wait();
+    }
+
+    void UCI::loop()
+    {
+        /* Executes commands until ``quit`` or the end of the input. */
+        std::string line;
+        while (std::getline(this->_in, line))
+        {
+            if (!this->execute(line))
+            {
+                return;
+            }
+        }
+        this->execute("quit");
+    }
+
+    bool UCI::execute(const std::string &line)
+    {
+        /*
+        Executes a single command line. Unknown commands are ignored.
+
+        Returns ``false`` after ``quit``.
+        */
+        std::istringstream is(line);
+        std::string command;
+        is >> command;
+
+        if (command == "uci")
+        {
+            this->_uci();
+        }
+        else if (command == "isready")
+        {
+            this->send("readyok");
+        }
+        else if (command == "ucinewgame")
+        {
+            this->_threads.clear();
+        }
+        else if (command == "position")
+        {
+            this->_position(is);
+        }
+        else if (command == "go")
+        {
+            this->_go(is);
+        }
+        else if (command == "stop")
+        {
+            this->_threads.stop();
+        }
+        else if (command == "ponderhit")
+        {
+            this->_threads.ponderhit();
+        }
+        else if (command == "setoption")
+        {
+            this->_setoption(is);
+        }
+        else if (command == "quit")
+        {
+            this->_threads.stop();
+            this->_threads.wait();
+            return false;
+        }
+        else if (!command.empty())
+        {
+            this->send("info string unknown command: " + line);
+        }
+        return true;
+    }
+
+    void UCI::send(const std::string &message)
+    {
+        /* Writes *message* and a newline at once and flushes. Thread-safe. */
+        std::lock_guard<std::mutex> lock(this->_out_mutex);
+        this->_out << message << '\n';
+        this->_out.flush();
+    }
+
+    std::string UCI::format_value(Value value)
+    {
+        /* Formats a score as ``cp <x>`` or ``mate <moves>``. */
+        if (value >= VALUE_MATE_IN_MAX_PLY)
+        {
+            return "mate " + std::to_string((VALUE_MATE - value + 1) / 2);
+        }
+        else if (value <= VALUE_MATED_IN_MAX_PLY)
+        {
+            return "mate " + std::to_string(-(VALUE_MATE + value) / 2);
+        }
+        return "cp " + std::to_string(value);
+    }
+
+    void UCI::_uci()
+    {
+        this->send("id name " + ENGINE_NAME + "\n"
+                   "id author winapiadmin\n"
+                   "option name Hash type spin default 4 min 0 max 65536\n"
+                   "option name Threads type spin default 1 min 1 max 1024\n"
+                   "option name MultiPV type spin default 1 min 1 max 500\n"
+                   "option name Move Overhead type spin default 10 min 0 max 5000\n"
+                   "option name EvalFile type string default <empty>\n"
+                   "option name Use NNUE type check default false\n"
+                   "option name Ponder type check default false\n"
+                   "uciok");
+    }
+
+    void UCI::_position(std::istringstream &is)
+    {
+        // position [startpos | fen <fen>] [moves <move1> ... <movei>]
+        std::string token, fen;
+        is >> token;
+        if (token == "startpos")
+        {
+            fen = STARTING_FEN;
+            is >> token;
+        }
+        else if (token == "fen")
+        {
+            while (is >> token && token != "moves")
+            {
+                fen += token + " ";
+            }
+        }
+        else
+        {
+            return;
+        }
+
+        Board board;
+        try
+        {
+            board = Board(fen);
+            while (is >> token)
+            {
+                board.push_uci(token);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            this->send(std::string("info string invalid position: ") + e.what());
+            return;
+        }
+        this->_board = board;
+    }
+
+    void UCI::_go(std::istringstream &is)
+    {
+        // go [searchmoves <moves>] [ponder] [wtime <x>] [btime <x>] [winc <x>]
+        //    [binc <x>] [movestogo <x>] [depth <x>] [nodes <x>] [mate <x>]
+        //    [movetime <x>] [infinite]
+        SearchLimits limits;
+        std::string token;
+        bool searchmoves = false;
+        while (is >> token)
+        {
+            if (token == "searchmoves")
+            {
+                searchmoves = true;
+                continue;
+            }
+            else if (token == "wtime")
+            {
+                is >> limits.time[WHITE];
+            }
+            else if (token == "btime")
+            {
+                is >> limits.time[BLACK];
+            }
+            else if (token == "winc")
+            {
+                is >> limits.inc[WHITE];
+            }
+            else if (token == "binc")
+            {
+                is >> limits.inc[BLACK];
+            }
+            else if (token == "movestogo")
+            {
+                is >> limits.movestogo;
+            }
+            else if (token == "depth")
+            {
+                is >> limits.depth;
+            }
+            else if (token == "nodes")
+            {
+                is >> limits.nodes;
+            }
+            else if (token == "mate")
+            {
+                is >> limits.mate;
+            }
+            else if (token == "movetime")
+            {
+                is >> limits.movetime;
+            }
+            else if (token == "infinite")
+            {
+                limits.infinite = true;
+            }
+            else if (token == "ponder")
+            {
+                limits.ponder = true;
+            }
+            else if (searchmoves)
+            {
+                try
+                {
+                    limits.searchmoves.push_back(this->_board.parse_uci(token));
+                }
+                catch (const std::invalid_argument &)
+                {
+                    this->send("info string ignoring searchmove: " + token);
+                }
+                continue;
+            }
+            searchmoves = false;
+        }
+
+        this->_threads.go(this->_board, limits);
+    }
+
+    void UCI::_setoption(std::istringstream &is)
+    {
+        // setoption name <id> [value <x>]
+        std::string token, name, value;
+        is >> token;
+        while (is >> token && token != "value")
+        {
+            name += (name.empty() ? "" : " ") + token;
+        }
+        while (is >> token)
+        {
+            value += (value.empty() ? "" : " ") + token;
+        }
+
+        try
+        {
+            if (name == "Hash")
+            {
+                // The evaluation cache of each thread is the only hash table.
+                EvalCache::configured_size = std::min(std::stoul(value), 65536ul);
+            }
+            else if (name == "Threads")
+            {
+                this->_threads.set_size(std::clamp(std::stoi(value), 1, 1024));
+            }
+            else if (name == "MultiPV")
+            {
+                this->_options.multipv = std::clamp(std::stoi(value), 1, 500);
+                this->_threads.set_options(this->_options);
+            }
+            else if (name == "Move Overhead")
+            {
+                this->_threads.set_move_overhead(std::clamp(std::stoi(value), 0, 5000));
+            }
+            else if (name == "EvalFile")
+            {
+                // The network must not change under a running search.
+                this->_threads.stop();
+                this->_threads.wait();
+                if (value.empty() || value == "<empty>")
+                {
+                    network().unload();
+                }
+                else
+                {
+                    try
+                    {
+                        network().load(value);
+                        this->send("info string loaded network " + value + " (" + NNUE::simd() + ")");
+                    }
+                    catch (const std::runtime_error &error)
+                    {
+                        this->send(std::string("info string ") + error.what());
+                    }
+                }
+            }
+            else if (name == "Use NNUE")
+            {
+                Network::enabled = value == "true";
+                if (Network::enabled && !network().loaded())
+                {
+                    this->send("info string no network loaded, using the classical evaluation");
+                }
+            }
+            else if (name == "Ponder")
+            {
+                // The GUI decides when to ponder; nothing to configure.
+            }
+            else
+            {
+                this->send("info string unknown option: " + name);
+            }
+        }
+        catch (const std::exception &)
+        {
+            this->send("info string invalid value for " + name + ": " + value);
+        }
+    }
+
+    void UCI::_on_iteration(const Search &search, int depth, Value)
+    {
+        // All lines of an iteration go out as one message.
+        int64_t elapsed = std::max<int64_t>(search.time.elapsed(), 1);
+        uint64_t nodes = this->_threads.nodes_searched();
+        std::string message;
+        for (size_t i = 0; i < search.pvs.size(); ++i)
+        {
+            if (i)
+            {
+                message += '\n';
+            }
+            message += "info depth " + std::to_string(depth);
+            if (search.options.multipv > 1)
+            {
+                message += " multipv " + std::to_string(i + 1);
+            }
+            message += " score " + format_value(search.pv_values[i]);
+            message += " nodes " + std::to_string(nodes);
+            message += " nps " + std::to_string(nodes * 1000 / elapsed);
+            message += " time " + std::to_string(elapsed);
+            message += " pv";
+
+            Board board = search.board;
+            for (const Move &move : search.pvs[i])
+            {
+                message += " " + board.uci(move);
+                board.push(move);
+            }
+        }
+        if (!message.empty())
+        {
+            this->send(message);
+        }
+    }
+
+    void UCI::_on_bestmove(const Search &search, const Move &best_move, const Move &ponder_move)
+    {
+        if (!best_move)
+        {
+            this->send("bestmove 0000");
+            return;
+        }
+
+        std::string message = "bestmove " + search.board.uci(best_move);
+        if (ponder_move)
+        {
+            Board board = search.board;
+            board.push(best_move);
+            message += " ponder " + board.uci(ponder_move);
+        }
+        this->send(message);
+    }
@@ -0,0 +1,59 @@
+#ifndef UCI_H_INCLUDED
+#define UCI_H_INCLUDED
+#include "thread.h"
+#include <iostream>
+#include <sstream>
+
+    const std::string ENGINE_NAME = "cppchess";
+
+    class UCI
+    {
+        /*
+        The Universal Chess Interface front end.
+
+        Commands are read on the calling thread and searches run on
+        :class:`SearchThreads`, so ``stop``, ``ponderhit`` and ``isready`` are
+        answered while searching. Each message (e.g., all ``info`` lines of
+        an iteration) is written with a single write and flush, under a lock
+        shared by both threads.
+        */
+
+    public:
+        UCI(std::istream & = std::cin, std::ostream & = std::cout);
+
+        ~UCI();
+
+        void loop();
+
+        bool execute(const std::string &);
+
+        void send(const std::string &);
+
+        static std::string format_value(Value);
+
+    private:
+        std::istream &_in;
+
+        std::ostream &_out;
+
+        std::mutex _out_mutex;
+
+        Board _board;
+
+        SearchThreads _threads;
+
+        SearchOptions _options;
+
+        void _uci();
+
+        void _position(std::istringstream &);
+
+        void _go(std::istringstream &);
+
+        void _setoption(std::istringstream &);
+
+        void _on_iteration(const Search &, int, Value);
+
+        void _on_bestmove(const Search &, const Move &, const Move &);
+    };
+#endif // UCI_H_INCLUDED